@@ -0,0 +1,98 @@
+#ifndef AdaptiveQuality_h
+#define AdaptiveQuality_h
+
+#include "DistModels.h"
+#include "LoadMonitor.h"
+
+#include <algorithm>
+
+// Picks the model size for the "Adaptive quality" mode from the processing load
+// (LoadMonitor::Stats, load 1.0 = a missed deadline).
+//
+// update() is called at a steady rate (the processor's 10 Hz timer) and returns
+// the size to run, never above the one the user chose. Steps down one size as
+// soon as load stays high for a couple of ticks, and steps back up only after a
+// hold-off and a long stretch in which the bigger model's predicted load would
+// still leave plenty of headroom, so it does not flip back and forth.
+class AdaptiveQuality
+{
+public:
+    static constexpr double maxLoadLimit = 0.85;     // worst block in a tick
+    static constexpr double averageLoadLimit = 0.5;
+    static constexpr double upgradeHeadroom = 0.5;   // predicted worst block after upgrading
+    static constexpr int ticksToDowngrade = 2;
+    static constexpr int ticksToUpgrade = 30;
+    static constexpr int holdTicksAfterDowngrade = 50;
+    static constexpr int settleTicks = 5;             // for the new model to take over
+
+    void reset() noexcept
+    {
+        cap = ModelSize::hidden32;
+        ticksOver = ticksUnder = holdTicks = settling = 0;
+    }
+
+    ModelSize update (const LoadMonitor::Stats& stats, ModelSize chosen) noexcept
+    {
+        const auto current = std::min (chosen, cap);
+
+        if (holdTicks > 0)
+            --holdTicks;
+
+        // nothing was processed (transport stopped): no evidence either way; and
+        // right after a change the load still partly belongs to the previous model
+        if (stats.numRecentBlocks == 0 || settling > 0)
+        {
+            settling = std::max (0, settling - 1);
+            return current;
+        }
+
+        if (stats.recentMaxLoad > maxLoadLimit || stats.recentAverageLoad > averageLoadLimit)
+        {
+            ticksUnder = 0;
+
+            if (++ticksOver >= ticksToDowngrade && current != ModelSize::hidden8)
+            {
+                cap = (ModelSize) ((int) current - 1);
+                ticksOver = 0;
+                holdTicks = holdTicksAfterDowngrade;
+                settling = settleTicks;
+            }
+
+            return std::min (chosen, cap);
+        }
+
+        ticksOver = 0;
+
+        if (current == chosen || holdTicks > 0)
+        {
+            ticksUnder = 0;
+            return current;
+        }
+
+        // inference cost grows with the square of the hidden size
+        const auto next = (ModelSize) ((int) current + 1);
+        const auto costRatio = (double) getHiddenSize (next) / getHiddenSize (current);
+
+        if (stats.recentMaxLoad * costRatio * costRatio < upgradeHeadroom)
+        {
+            if (++ticksUnder >= ticksToUpgrade)
+            {
+                cap = next;
+                ticksUnder = 0;
+                settling = settleTicks;
+            }
+        }
+        else
+        {
+            ticksUnder = 0;
+        }
+
+        return std::min (chosen, cap);
+    }
+
+private:
+    ModelSize cap = ModelSize::hidden32;
+    int ticksOver = 0, ticksUnder = 0, holdTicks = 0, settling = 0;
+};
+
+#endif /* AdaptiveQuality_h */
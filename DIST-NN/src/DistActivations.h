@@ -0,0 +1,107 @@
+#ifndef DistActivations_h
+#define DistActivations_h
+
+#include <cmath>
+#include <string>
+
+// Gate activations for DistLSTM, in accuracy tiers. The approximations are
+// rational (Padé / Lambert continued fraction) forms of tanh, clamped where they
+// reach +-1, with sigmoid (x) = 0.5 + 0.5 * tanh (x / 2). They have no branches
+// and no library calls, so the activation loops vectorize; std::exp and
+// std::tanh do not.
+//
+// Largest absolute error against std::tanh (sigmoid is half of it):
+//   exact   0
+//   high    1e-4
+//   medium  1.4e-3
+//   fast    2.4e-2
+// distnn-sweep measures what each tier does to the rendered audio.
+enum class ActivationQuality { exact = 0, high, medium, fast };
+
+#ifndef DISTNN_DEFAULT_ACTIVATIONS
+ #define DISTNN_DEFAULT_ACTIVATIONS 0   // build with -DDISTNN_DEFAULT_ACTIVATIONS=1..3 to change the default tier
+#endif
+
+constexpr auto defaultActivationQuality = (ActivationQuality) DISTNN_DEFAULT_ACTIVATIONS;
+
+constexpr int numActivationQualities = 4;
+
+inline const char* getActivationQualityName (ActivationQuality quality)
+{
+    switch (quality)
+    {
+        case ActivationQuality::exact:  return "exact";
+        case ActivationQuality::high:   return "high";
+        case ActivationQuality::medium: return "medium";
+        case ActivationQuality::fast:   return "fast";
+    }
+
+    return "";
+}
+
+inline bool getActivationQuality (const std::string& name, ActivationQuality& quality)
+{
+    for (int i = 0; i < numActivationQualities; ++i)
+    {
+        if (name == getActivationQualityName ((ActivationQuality) i))
+        {
+            quality = (ActivationQuality) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+struct ExactActivations
+{
+    static float sigmoid (float x) noexcept { return 1.0f / (1.0f + std::exp (-x)); }
+    static float tanh (float x) noexcept    { return std::tanh (x); }
+};
+
+// x in [-limit, limit] without branches. Written with fabs rather than
+// comparisons, which GCC turns into branches and will not vectorize without
+// -ffast-math; the rounding costs at most 2.5e-7, far below any tier's error.
+inline float clampActivation (float x, float limit) noexcept
+{
+    return 0.5f * (std::fabs (x + limit) - std::fabs (x - limit));
+}
+
+struct HighActivations
+{
+    static float tanh (float x) noexcept
+    {
+        x = clampActivation (x, 4.97178686f);
+        const auto x2 = x * x;
+        return x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)))
+                 / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
+    }
+
+    static float sigmoid (float x) noexcept { return 0.5f + 0.5f * tanh (0.5f * x); }
+};
+
+struct MediumActivations
+{
+    static float tanh (float x) noexcept
+    {
+        x = clampActivation (x, 3.64673860f);
+        const auto x2 = x * x;
+        return x * (945.0f + x2 * (105.0f + x2)) / (945.0f + x2 * (420.0f + x2 * 15.0f));
+    }
+
+    static float sigmoid (float x) noexcept { return 0.5f + 0.5f * tanh (0.5f * x); }
+};
+
+struct FastActivations
+{
+    static float tanh (float x) noexcept
+    {
+        x = clampActivation (x, 3.0f);
+        const auto x2 = x * x;
+        return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+    }
+
+    static float sigmoid (float x) noexcept { return 0.5f + 0.5f * tanh (0.5f * x); }
+};
+
+#endif /* DistActivations_h */
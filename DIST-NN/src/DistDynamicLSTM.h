@@ -0,0 +1,160 @@
+#ifndef DistDynamicLSTM_h
+#define DistDynamicLSTM_h
+
+#include <RTNeural/RTNeural.h>
+#include "DistActivations.h"
+
+#include <memory>
+
+// Fallback engine for DIST-NN models whose hidden size has no static
+// specialization (see DistModelVariant): RTNeural's run-time sized Model, built
+// from the same PyTorch state dict, one model per lane. It is several times
+// slower than DistLSTM and is there so that any training run can be tried
+// straight away; add the size to DistModelVariant once it is worth keeping.
+//
+// Same interface as DistLSTM, so the plugin and the tools run it like any other
+// alternative. There is no silence skipping, and the activations are always
+// RTNeural's own (exact) ones.
+class DistDynamicLSTM
+{
+public:
+    using Weights = nlohmann::json;   // the state dict, with the shapes checked by getHiddenSize
+    static constexpr int numLanes = 2;
+
+    explicit DistDynamicLSTM (std::shared_ptr<const Weights> modelJson)
+        : weights (std::move (modelJson))
+    {
+        for (auto& model : models)
+            model = makeModel (*weights);
+
+        reset();
+    }
+
+    // RTNeural models cannot be copied, so copies are rebuilt from the weights and
+    // start from a reset state. Allocates: never copy one on the audio thread.
+    DistDynamicLSTM (const DistDynamicLSTM& other)
+        : DistDynamicLSTM (other.weights)
+    {
+        smoothingLength = other.smoothingLength;
+    }
+
+    DistDynamicLSTM& operator= (const DistDynamicLSTM& other)
+    {
+        auto copy = other;
+        return *this = std::move (copy);
+    }
+
+    DistDynamicLSTM (DistDynamicLSTM&&) = default;
+    DistDynamicLSTM& operator= (DistDynamicLSTM&&) = default;
+
+    // Hidden size of a SimpleLSTM state dict (2 inputs, one LSTM layer, Dense to
+    // one output), or 0 if the keys or shapes do not match.
+    static int getHiddenSize (const nlohmann::json& modelJson)
+    {
+        for (auto* key : { "lstm.weight_ih_l0", "lstm.weight_hh_l0", "lstm.bias_ih_l0", "lstm.bias_hh_l0", "dense.weight", "dense.bias" })
+            if (! modelJson.contains (key) || ! modelJson[key].is_array())
+                return 0;
+
+        const auto& weightIh = modelJson["lstm.weight_ih_l0"];
+        const auto& weightHh = modelJson["lstm.weight_hh_l0"];
+        const auto& denseWeight = modelJson["dense.weight"];
+        const auto numGates = weightIh.size();
+        const auto hiddenSize = numGates / 4;
+
+        if (hiddenSize == 0 || numGates % 4 != 0 || weightHh.size() != numGates
+            || modelJson["lstm.bias_ih_l0"].size() != numGates || modelJson["lstm.bias_hh_l0"].size() != numGates
+            || denseWeight.size() != 1 || denseWeight[0].size() != hiddenSize || modelJson["dense.bias"].size() != 1)
+            return 0;
+
+        for (size_t k = 0; k < numGates; ++k)
+            if (weightIh[k].size() != 2 || weightHh[k].size() != hiddenSize)
+                return 0;
+
+        return (int) hiddenSize;
+    }
+
+    void reset() noexcept
+    {
+        for (auto& model : models)
+            model->reset();
+
+        snapToEffect = true;
+    }
+
+    void setEffect (float newEffect) noexcept
+    {
+        if (snapToEffect)
+        {
+            snapToEffect = false;
+            effectSamplesLeft = 0;
+            currentEffect = targetEffect = newEffect;
+        }
+        else if (newEffect != targetEffect)
+        {
+            targetEffect = newEffect;
+            effectSamplesLeft = smoothingLength;
+            effectIncrement = (targetEffect - currentEffect) / (float) smoothingLength;
+        }
+    }
+
+    void setSmoothingLength (int numSamples) noexcept
+    {
+        smoothingLength = numSamples > 0 ? numSamples : 1;
+    }
+
+    void setSilenceSkipping (bool) noexcept {}
+    bool isIdle() const noexcept { return false; }
+
+    void setActivationQuality (ActivationQuality) noexcept {}
+    ActivationQuality getActivationQuality() const noexcept { return ActivationQuality::exact; }
+
+    // Processes up to numLanes channels in place, one sample at a time.
+    void process (float* const* channels, int numChannels, int numSamples, float effect) noexcept
+    {
+        setEffect (effect);
+        numChannels = numChannels < numLanes ? numChannels : numLanes;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            if (effectSamplesLeft > 0)
+                currentEffect = --effectSamplesLeft == 0 ? targetEffect : currentEffect + effectIncrement;
+
+            for (int lane = 0; lane < numChannels; ++lane)
+            {
+                alignas (16) const float input[] = { channels[lane][n], currentEffect };
+                channels[lane][n] = models[lane]->forward (input);
+            }
+        }
+    }
+
+    const Weights& getWeights() const noexcept { return *weights; }
+    const std::shared_ptr<const Weights>& getSharedWeights() const noexcept { return weights; }
+
+private:
+    static std::unique_ptr<RTNeural::Model<float>> makeModel (const nlohmann::json& modelJson)
+    {
+        const auto hiddenSize = getHiddenSize (modelJson);
+
+        auto lstm = std::make_unique<RTNeural::LSTMLayer<float>> (2, hiddenSize);
+        RTNeural::torch_helpers::loadLSTM<float> (modelJson, "lstm.", *lstm);
+
+        auto dense = std::make_unique<RTNeural::Dense<float>> (hiddenSize, 1);
+        RTNeural::torch_helpers::loadDense<float> (modelJson, "dense.", *dense);
+
+        auto model = std::make_unique<RTNeural::Model<float>> (2);
+        model->addLayer (lstm.release());
+        model->addLayer (dense.release());
+        model->reset();
+        return model;
+    }
+
+    std::shared_ptr<const Weights> weights;
+    std::unique_ptr<RTNeural::Model<float>> models[numLanes];
+
+    float currentEffect = 0.0f, targetEffect = 0.0f, effectIncrement = 0.0f;
+    int effectSamplesLeft = 0;
+    int smoothingLength = 256;
+    bool snapToEffect = true;
+};
+
+#endif /* DistDynamicLSTM_h */
@@ -0,0 +1,122 @@
+#ifndef DistGRU_h
+#define DistGRU_h
+
+#include "DistRecurrentEngine.h"
+
+#include <cmath>
+#include <memory>
+
+// Weights of the GRU variant of the DIST-NN topology (2-input GRU followed by a
+// Dense layer to one output, SimpleGRU on the python side), laid out like
+// DistWeights. Gates follow the PyTorch order: reset, update, new. Three gates
+// instead of four, and no cell state, so a step costs about a quarter less than
+// the LSTM of the same width.
+template <int hiddenSize>
+struct DistGRUWeights
+{
+    static constexpr int numGates = 3 * hiddenSize;
+
+    alignas (32) float inputWeights[numGates];                  // weight_ih, audio column
+    alignas (32) float conditionWeights[numGates];              // weight_ih, "effect" column
+    alignas (32) float recurrentWeights[hiddenSize][numGates];  // weight_hh, transposed
+    alignas (32) float bias[numGates];                          // bias_ih, plus bias_hh for reset and update
+    alignas (32) float newGateBias[hiddenSize];                 // bias_hh of the new gate, scaled by the reset gate
+    alignas (32) float denseWeights[hiddenSize];
+    float denseBias = 0.0f;
+
+    // gates[lane] += weight_hh * hidden[lane], walking each weight row once for every lane
+    template <int numLanes>
+    void addRecurrent (const float (&hidden)[numLanes][hiddenSize], float (&gates)[numLanes][numGates]) const noexcept
+    {
+        for (int j = 0; j < hiddenSize; ++j)
+        {
+            float h[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                h[lane] = hidden[lane][j];
+
+            const float* row = recurrentWeights[j];
+
+            for (int k = 0; k < numGates; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    gates[lane][k] += row[k] * h[lane];
+        }
+    }
+};
+
+// DistLSTM's counterpart for GRU models: the same DistRecurrentEngine (lanes,
+// sub-blocks, effect smoothing, silence skipping, activation tiers) with a GRU
+// cell, so the plugin and the tools run it like any other alternative. Float
+// weights only.
+//
+// The new gate needs the recurrent product on its own (the reset gate scales it
+// before the input part is added), so each step starts the recurrent sums from
+// the input projection for reset and update and from newGateBias for the new
+// gate, and adds the input projection of the new gate after the reset.
+template <int hiddenSize, int numLanes = 2>
+class DistGRU : public DistRecurrentEngine<DistGRU<hiddenSize, numLanes>, hiddenSize, numLanes, DistGRUWeights<hiddenSize>>
+{
+    using Engine = DistRecurrentEngine<DistGRU, hiddenSize, numLanes, DistGRUWeights<hiddenSize>>;
+    friend Engine;
+
+public:
+    using typename Engine::Weights;
+    using Engine::numGates;
+
+    explicit DistGRU (std::shared_ptr<const Weights> modelWeights)
+        : Engine (std::move (modelWeights))
+    {
+        this->reset();
+    }
+
+private:
+    // the hidden state is all there is
+    void resetState() noexcept {}
+
+    // Runs the recurrence for one sample from the input projection of every lane.
+    // Returns the largest change of any state value, for the silence detection.
+    template <typename Activations>
+    float updateState (const float (&inputPart)[numLanes][numGates]) noexcept
+    {
+        const auto& w = *this->weights;
+        auto& hidden = this->hidden;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            for (int k = 0; k < 2 * hiddenSize; ++k)
+                gates[lane][k] = inputPart[lane][k];
+
+            for (int i = 0; i < hiddenSize; ++i)
+                gates[lane][2 * hiddenSize + i] = w.newGateBias[i];
+        }
+
+        w.addRecurrent (hidden, gates);
+
+        float change = 0.0f;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            float* gate = gates[lane];
+
+            for (int k = 0; k < 2 * hiddenSize; ++k)
+                gate[k] = Activations::sigmoid (gate[k]);
+
+            for (int i = 0; i < hiddenSize; ++i)
+                gate[2 * hiddenSize + i] = Activations::tanh (inputPart[lane][2 * hiddenSize + i] + gate[i] * gate[2 * hiddenSize + i]);
+
+            for (int i = 0; i < hiddenSize; ++i)
+            {
+                const auto newGate = gate[2 * hiddenSize + i];
+                const auto newHidden = newGate + gate[hiddenSize + i] * (hidden[lane][i] - newGate);
+                change = std::fmax (change, std::fabs (newHidden - hidden[lane][i]));
+                hidden[lane][i] = newHidden;
+            }
+        }
+
+        return change;
+    }
+
+    alignas (32) float gates[numLanes][numGates];
+};
+
+#endif /* DistGRU_h */
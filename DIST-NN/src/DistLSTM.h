@@ -0,0 +1,195 @@
+#ifndef DistLSTM_h
+#define DistLSTM_h
+
+#include "DistRecurrentEngine.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+// Weights of the DIST-NN topology (2-input LSTM followed by a Dense layer to one
+// output), laid out for the lane-parallel engine below. Gates follow the PyTorch
+// order: input, forget, cell, output.
+template <int hiddenSize>
+struct DistWeights
+{
+    static constexpr int numGates = 4 * hiddenSize;
+
+    alignas (32) float inputWeights[numGates];                  // weight_ih, audio column
+    alignas (32) float conditionWeights[numGates];              // weight_ih, "effect" column
+    alignas (32) float recurrentWeights[hiddenSize][numGates];  // weight_hh, transposed
+    alignas (32) float bias[numGates];                          // bias_ih + bias_hh
+    alignas (32) float denseWeights[hiddenSize];
+    float denseBias = 0.0f;
+
+    // gates[lane] += weight_hh * hidden[lane], walking each weight row once for every lane
+    template <int numLanes>
+    void addRecurrent (const float (&hidden)[numLanes][hiddenSize], float (&gates)[numLanes][numGates]) const noexcept
+    {
+        for (int j = 0; j < hiddenSize; ++j)
+        {
+            float h[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                h[lane] = hidden[lane][j];
+
+            const float* row = recurrentWeights[j];
+
+            for (int k = 0; k < numGates; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    gates[lane][k] += row[k] * h[lane];
+        }
+    }
+};
+
+// Same topology with weight_hh, the bulk of the weights, stored as int8 with one
+// scale per gate row: a quarter of the float footprint to keep in cache.
+template <int hiddenSize>
+struct DistQuantizedWeights
+{
+    static constexpr int numGates = 4 * hiddenSize;
+
+    alignas (32) float inputWeights[numGates];
+    alignas (32) float conditionWeights[numGates];
+    alignas (32) int8_t recurrentWeights[hiddenSize][numGates];  // weight_hh, transposed
+    alignas (32) float recurrentScales[numGates];                // one per weight_hh row
+    alignas (32) float bias[numGates];
+    alignas (32) float denseWeights[hiddenSize];
+    float denseBias = 0.0f;
+
+    template <int numLanes>
+    void addRecurrent (const float (&hidden)[numLanes][hiddenSize], float (&gates)[numLanes][numGates]) const noexcept
+    {
+        alignas (32) float sums[numLanes][numGates] {};
+
+        for (int j = 0; j < hiddenSize; ++j)
+        {
+            float h[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                h[lane] = hidden[lane][j];
+
+            const int8_t* row = recurrentWeights[j];
+
+            for (int k = 0; k < numGates; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    sums[lane][k] += (float) row[k] * h[lane];
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+            for (int k = 0; k < numGates; ++k)
+                gates[lane][k] += sums[lane][k] * recurrentScales[k];
+    }
+
+    static std::shared_ptr<DistQuantizedWeights> quantize (const DistWeights<hiddenSize>& source)
+    {
+        auto weights = std::make_shared<DistQuantizedWeights>();
+
+        for (int k = 0; k < numGates; ++k)
+        {
+            float largest = 0.0f;
+
+            for (int j = 0; j < hiddenSize; ++j)
+                largest = std::fmax (largest, std::fabs (source.recurrentWeights[j][k]));
+
+            const auto scale = largest > 0.0f ? largest / 127.0f : 1.0f;
+            weights->recurrentScales[k] = scale;
+
+            for (int j = 0; j < hiddenSize; ++j)
+                weights->recurrentWeights[j][k] = (int8_t) std::lround (source.recurrentWeights[j][k] / scale);
+
+            weights->inputWeights[k] = source.inputWeights[k];
+            weights->conditionWeights[k] = source.conditionWeights[k];
+            weights->bias[k] = source.bias[k];
+        }
+
+        for (int i = 0; i < hiddenSize; ++i)
+            weights->denseWeights[i] = source.denseWeights[i];
+
+        weights->denseBias = source.denseBias;
+        return weights;
+    }
+};
+
+// Runs `numLanes` independent channels through the same LSTM+Dense weights.
+// Every lane keeps its own hidden and cell state, and each step walks the
+// recurrent matrix once for all lanes, so the weight loads are shared and the
+// inner loops vectorize across the gates. WeightsType selects the weight
+// storage (DistWeights or DistQuantizedWeights). Effect smoothing, sub-blocks
+// and silence skipping come from DistRecurrentEngine.
+template <int hiddenSize, int numLanes = 2, typename WeightsType = DistWeights<hiddenSize>>
+class DistLSTM : public DistRecurrentEngine<DistLSTM<hiddenSize, numLanes, WeightsType>, hiddenSize, numLanes, WeightsType>
+{
+    using Engine = DistRecurrentEngine<DistLSTM, hiddenSize, numLanes, WeightsType>;
+    friend Engine;
+
+public:
+    using typename Engine::Weights;
+    using Engine::numGates;
+
+    explicit DistLSTM (std::shared_ptr<const Weights> modelWeights)
+        : Engine (std::move (modelWeights))
+    {
+        this->reset();
+    }
+
+private:
+    void resetState() noexcept
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+            for (int i = 0; i < hiddenSize; ++i)
+                cell[lane][i] = 0.0f;
+    }
+
+    // Adds the recurrence to the input projection, applies the gate activations
+    // in place and advances every lane's state. Returns the largest change of any
+    // state value, for the silence detection.
+    template <typename Activations>
+    float updateState (float (&activations)[numLanes][numGates]) noexcept
+    {
+        auto& hidden = this->hidden;
+        this->weights->addRecurrent (hidden, activations);
+
+        float change = 0.0f;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            // each gate segment in one loop, so the approximations vectorize
+            float* gate = activations[lane];
+
+            for (int k = 0; k < 2 * hiddenSize; ++k)
+                gate[k] = Activations::sigmoid (gate[k]);
+
+            for (int k = 2 * hiddenSize; k < 3 * hiddenSize; ++k)
+                gate[k] = Activations::tanh (gate[k]);
+
+            for (int k = 3 * hiddenSize; k < numGates; ++k)
+                gate[k] = Activations::sigmoid (gate[k]);
+
+            for (int i = 0; i < hiddenSize; ++i)
+            {
+                const auto newCell = gate[hiddenSize + i] * cell[lane][i] + gate[i] * gate[2 * hiddenSize + i];
+                cellActivation[i] = Activations::tanh (newCell);
+                change = std::fmax (change, std::fabs (newCell - cell[lane][i]));
+                cell[lane][i] = newCell;
+            }
+
+            for (int i = 0; i < hiddenSize; ++i)
+            {
+                const auto newHidden = gate[3 * hiddenSize + i] * cellActivation[i];
+                change = std::fmax (change, std::fabs (newHidden - hidden[lane][i]));
+                hidden[lane][i] = newHidden;
+            }
+        }
+
+        return change;
+    }
+
+    alignas (32) float cell[numLanes][hiddenSize];
+    alignas (32) float cellActivation[hiddenSize];
+};
+
+template <int hiddenSize, int numLanes = 2>
+using DistQuantizedLSTM = DistLSTM<hiddenSize, numLanes, DistQuantizedWeights<hiddenSize>>;
+
+#endif /* DistLSTM_h */
@@ -0,0 +1,315 @@
+#ifndef DistModelFile_h
+#define DistModelFile_h
+
+#include "DistLSTM.h"
+#include "DistGRU.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Binary DIST-NN model format (.dnnb), written by distnn-convert from the JSON
+// exported by SimpleLSTM (or SimpleGRU).save_for_rtneural.
+//
+// The cell type field tells LSTM models (DistWeights) from GRU ones
+// (DistGRUWeights); GRU models are float32 or float16 only.
+//
+// The precision field selects how the weights are stored:
+//  - float32: the DistWeights struct as is
+//  - float16: every float of DistWeights as IEEE half, converted back on load
+//    (half the file size, same engine)
+//  - int8:    the DistQuantizedWeights struct, run by the int8 engine
+//
+// A 64-byte header is followed by the weights already in the engine's layout,
+// so loading float32 or int8 is a single memcpy, or no copy at all when the data is suitably
+// aligned. The payload layout is the in-memory struct, so files are only valid
+// for little-endian targets with the usual float/alignment rules, which covers
+// every platform the plugin is built for.
+
+struct DistModelFileHeader
+{
+    static constexpr uint32_t currentVersion = 1;
+
+    enum CellType : uint32_t { lstm = 0, gru = 1 };
+    enum Precision : uint32_t { float32 = 0, float16 = 1, int8 = 2 };
+
+    char magic[4] { 'D', 'N', 'N', 'B' };
+    uint32_t version = currentVersion;
+    uint32_t cellType = lstm;
+    uint32_t hiddenSize = 0;
+    uint32_t inputSize = 2;
+    uint32_t precision = float32;
+    uint32_t payloadOffset = 64;
+    uint32_t payloadSize = 0;
+    uint64_t payloadHash = 0;
+    uint8_t reserved[24] {};
+};
+
+static_assert (sizeof (DistModelFileHeader) == 64, "the header is part of the file format");
+
+// FNV-1a, used to detect truncated or corrupted payloads.
+inline uint64_t hashDistModelData (const void* data, size_t size) noexcept
+{
+    auto* bytes = static_cast<const uint8_t*> (data);
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+inline bool isDistModelFile (const void* data, size_t size) noexcept
+{
+    return size >= sizeof (DistModelFileHeader) && std::memcmp (data, "DNNB", 4) == 0;
+}
+
+// Validates the header and the payload. Returns false for anything this build cannot read.
+inline bool readDistModelHeader (const void* data, size_t size, DistModelFileHeader& header) noexcept
+{
+    if (! isDistModelFile (data, size))
+        return false;
+
+    std::memcpy (&header, data, sizeof (header));
+
+    return header.version == DistModelFileHeader::currentVersion
+        && header.payloadOffset >= sizeof (DistModelFileHeader)
+        && (size_t) header.payloadOffset + header.payloadSize <= size
+        && header.payloadHash == hashDistModelData (static_cast<const char*> (data) + header.payloadOffset, header.payloadSize);
+}
+
+inline uint16_t floatToHalf (float value) noexcept
+{
+    uint32_t bits;
+    std::memcpy (&bits, &value, 4);
+
+    const auto sign = (uint16_t) ((bits >> 16) & 0x8000u);
+    const auto exponent = (int) ((bits >> 23) & 0xffu) - 127 + 15;
+    auto mantissa = bits & 0x7fffffu;
+
+    if (exponent >= 31)
+        return (uint16_t) (sign | 0x7c00u | ((bits & 0x7fffffffu) > 0x7f800000u ? 0x200u : 0u));
+
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return sign;
+
+        // subnormal half, round to nearest even
+        mantissa |= 0x800000u;
+        const auto shift = (uint32_t) (14 - exponent);
+        auto half = mantissa >> shift;
+        const auto remainder = mantissa & ((1u << shift) - 1u), midpoint = 1u << (shift - 1);
+
+        if (remainder > midpoint || (remainder == midpoint && (half & 1u) != 0))
+            ++half;
+
+        return (uint16_t) (sign | half);
+    }
+
+    auto half = (uint32_t) (exponent << 10) | (mantissa >> 13);
+    const auto remainder = mantissa & 0x1fffu;
+
+    // round to nearest even, a carry into the exponent is still correct
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u) != 0))
+        ++half;
+
+    return (uint16_t) (sign | half);
+}
+
+inline float halfToFloat (uint16_t half) noexcept
+{
+    const auto sign = (uint32_t) (half & 0x8000u) << 16;
+    auto exponent = (int) ((half >> 10) & 0x1fu);
+    auto mantissa = (uint32_t) (half & 0x3ffu);
+    uint32_t bits;
+
+    if (exponent == 31)
+    {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // subnormal half: normalise it
+            exponent = 1;
+
+            while ((mantissa & 0x400u) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+
+            bits = sign | (uint32_t) (exponent - 15 + 127) << 23 | ((mantissa & 0x3ffu) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | (uint32_t) (exponent - 15 + 127) << 23 | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy (&value, &bits, 4);
+    return value;
+}
+
+// Uses a payload in place when it is aligned for T, `owner` keeping it alive
+// (nullptr for static data such as BinaryData); otherwise copies it once.
+template <typename T>
+std::shared_ptr<const T> viewDistModelPayload (const char* payload, std::shared_ptr<const void> owner)
+{
+    if (reinterpret_cast<uintptr_t> (payload) % alignof (T) == 0)
+    {
+        auto* object = reinterpret_cast<const T*> (payload);
+
+        if (owner == nullptr)
+            return std::shared_ptr<const T> (object, [] (const T*) {});
+
+        return std::shared_ptr<const T> (std::move (owner), object);
+    }
+
+    auto object = std::make_shared<T>();
+    std::memcpy (static_cast<void*> (object.get()), payload, sizeof (T));
+    return object;
+}
+
+inline bool isDistModelHeaderFor (const DistModelFileHeader& header, int hiddenSize, uint32_t precision, size_t payloadSize,
+                                  uint32_t cellType = DistModelFileHeader::lstm)
+{
+    return header.cellType == cellType && header.precision == precision
+        && header.hiddenSize == (uint32_t) hiddenSize && header.inputSize == 2 && header.payloadSize == payloadSize;
+}
+
+// Returns the float weights (DistWeights or DistGRUWeights) stored in a float32
+// or float16 .dnnb file of the given cell type.
+template <typename Weights>
+std::shared_ptr<const Weights> readDistFloatWeights (const void* data, size_t size, std::shared_ptr<const void> owner,
+                                                     int hiddenSize, uint32_t cellType)
+{
+    static_assert (sizeof (Weights) % sizeof (float) == 0, "the float16 format converts the struct float by float");
+
+    DistModelFileHeader header;
+
+    if (! readDistModelHeader (data, size, header))
+        return nullptr;
+
+    auto* payload = static_cast<const char*> (data) + header.payloadOffset;
+
+    if (isDistModelHeaderFor (header, hiddenSize, DistModelFileHeader::float32, sizeof (Weights), cellType))
+        return viewDistModelPayload<Weights> (payload, std::move (owner));
+
+    if (isDistModelHeaderFor (header, hiddenSize, DistModelFileHeader::float16, sizeof (Weights) / 2, cellType))
+    {
+        auto weights = std::make_shared<Weights>();
+        auto* values = reinterpret_cast<float*> (weights.get());
+
+        for (size_t i = 0; i < sizeof (Weights) / sizeof (float); ++i)
+        {
+            uint16_t half;
+            std::memcpy (&half, payload + 2 * i, 2);
+            values[i] = halfToFloat (half);
+        }
+
+        return weights;
+    }
+
+    return nullptr;
+}
+
+template <int hiddenSize>
+std::shared_ptr<const DistWeights<hiddenSize>> readDistWeights (const void* data, size_t size,
+                                                                std::shared_ptr<const void> owner = nullptr)
+{
+    return readDistFloatWeights<DistWeights<hiddenSize>> (data, size, std::move (owner), hiddenSize, DistModelFileHeader::lstm);
+}
+
+template <int hiddenSize>
+std::shared_ptr<const DistGRUWeights<hiddenSize>> readDistGRUWeights (const void* data, size_t size,
+                                                                      std::shared_ptr<const void> owner = nullptr)
+{
+    return readDistFloatWeights<DistGRUWeights<hiddenSize>> (data, size, std::move (owner), hiddenSize, DistModelFileHeader::gru);
+}
+
+// Returns the int8 weights stored in an int8 .dnnb file.
+template <int hiddenSize>
+std::shared_ptr<const DistQuantizedWeights<hiddenSize>> readDistQuantizedWeights (const void* data, size_t size,
+                                                                                  std::shared_ptr<const void> owner = nullptr)
+{
+    using Weights = DistQuantizedWeights<hiddenSize>;
+    DistModelFileHeader header;
+
+    if (! readDistModelHeader (data, size, header)
+        || ! isDistModelHeaderFor (header, hiddenSize, DistModelFileHeader::int8, sizeof (Weights)))
+        return nullptr;
+
+    return viewDistModelPayload<Weights> (static_cast<const char*> (data) + header.payloadOffset, std::move (owner));
+}
+
+inline std::vector<char> writeDistModelFile (DistModelFileHeader header, const void* payload)
+{
+    header.payloadHash = hashDistModelData (payload, header.payloadSize);
+
+    std::vector<char> file (header.payloadOffset + header.payloadSize);
+    std::memcpy (file.data(), &header, sizeof (header));
+    std::memcpy (file.data() + header.payloadOffset, payload, header.payloadSize);
+    return file;
+}
+
+// Writes float weights as float16 when the header asks for it, float32 otherwise.
+template <typename Weights>
+std::vector<char> writeDistFloatModelFile (const Weights& weights, DistModelFileHeader header)
+{
+    if (header.precision == DistModelFileHeader::float16)
+    {
+        const auto* values = reinterpret_cast<const float*> (&weights);
+        std::vector<uint16_t> halves (sizeof (weights) / sizeof (float));
+
+        for (size_t i = 0; i < halves.size(); ++i)
+            halves[i] = floatToHalf (values[i]);
+
+        header.payloadSize = (uint32_t) (halves.size() * sizeof (uint16_t));
+        return writeDistModelFile (header, halves.data());
+    }
+
+    header.precision = DistModelFileHeader::float32;
+    header.payloadSize = (uint32_t) sizeof (weights);
+    return writeDistModelFile (header, &weights);
+}
+
+template <int hiddenSize>
+std::vector<char> writeDistModelFile (const DistWeights<hiddenSize>& weights,
+                                      uint32_t precision = DistModelFileHeader::float32)
+{
+    DistModelFileHeader header;
+    header.hiddenSize = (uint32_t) hiddenSize;
+    header.precision = precision;
+
+    if (precision == DistModelFileHeader::int8)
+    {
+        const auto quantized = DistQuantizedWeights<hiddenSize>::quantize (weights);
+        header.payloadSize = (uint32_t) sizeof (*quantized);
+        return writeDistModelFile (header, quantized.get());
+    }
+
+    return writeDistFloatModelFile (weights, header);
+}
+
+// GRU models have no int8 engine: int8 is written as float32.
+template <int hiddenSize>
+std::vector<char> writeDistModelFile (const DistGRUWeights<hiddenSize>& weights,
+                                      uint32_t precision = DistModelFileHeader::float32)
+{
+    DistModelFileHeader header;
+    header.cellType = DistModelFileHeader::gru;
+    header.hiddenSize = (uint32_t) hiddenSize;
+    header.precision = precision;
+    return writeDistFloatModelFile (weights, header);
+}
+
+#endif /* DistModelFile_h */
@@ -0,0 +1,487 @@
+#ifndef DistModels_h
+#define DistModels_h
+
+#include <RTNeural/RTNeural.h>
+#include "DistLSTM.h"
+#include "DistGRU.h"
+#include "DistDynamicLSTM.h"
+#include "DistSharedLSTM.h"
+#include "DistModelFile.h"
+#include "DistWeightCache.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+// GRU models are only built in with DISTNN_GRU set (the CMake option of the same
+// name): until a trained one ships, they would only grow the variant.
+#ifndef DISTNN_GRU
+ #define DISTNN_GRU 0
+#endif
+
+// All the DIST-NN models share the same topology: a 2-input LSTM (audio sample
+// plus the "effect" conditioning value) followed by a Dense layer back to one
+// output. Only the hidden size changes, so every size we ship gets its own fully
+// static specialization and the active one is picked through a variant.
+//
+// DistModelT is the plain RTNeural model, kept as the reference implementation.
+// The plugin runs DistLSTM, which processes both stereo channels in one pass,
+// with float weights or, when the model file asks for it, int8 ones. JSON models
+// of any other hidden size fall back to DistDynamicLSTM. Models trained as
+// SimpleGRU (a GRU in place of the LSTM) run on DistGRU, with DistGRUModelT as
+// their reference, at the same four sizes, in builds with DISTNN_GRU; other
+// builds reject them like any unknown model. DistSharedLSTM, the last
+// alternative, batches engines across instances (see makeDistSharedModelBank).
+template <int hiddenSize>
+using DistModelT = RTNeural::ModelT<float, 2, 1,
+                                    RTNeural::LSTMLayerT<float, 2, hiddenSize>,
+                                    RTNeural::DenseT<float, hiddenSize, 1>>;
+
+template <int hiddenSize>
+using DistGRUModelT = RTNeural::ModelT<float, 2, 1,
+                                       RTNeural::GRULayerT<float, 2, hiddenSize>,
+                                       RTNeural::DenseT<float, hiddenSize, 1>>;
+
+using DistModelVariant = std::variant<DistLSTM<8>, DistLSTM<16>, DistLSTM<24>, DistLSTM<32>,
+                                      DistQuantizedLSTM<8>, DistQuantizedLSTM<16>, DistQuantizedLSTM<24>, DistQuantizedLSTM<32>,
+                                     #if DISTNN_GRU
+                                      DistGRU<8>, DistGRU<16>, DistGRU<24>, DistGRU<32>,
+                                     #endif
+                                      DistDynamicLSTM, DistSharedLSTM>;
+
+template <typename Engine>
+constexpr bool isDistGRU = false;
+
+template <int hiddenSize, int numLanes>
+constexpr bool isDistGRU<DistGRU<hiddenSize, numLanes>> = true;
+
+enum class ModelSize
+{
+    hidden8 = 0,
+    hidden16,
+    hidden24,
+    hidden32
+};
+
+constexpr int numModelSizes = 4;
+
+// rate of the training data (myk_data.generate_dataset), which the models are tied to
+constexpr double distModelSampleRate = 44100.0;
+
+inline int getHiddenSize (ModelSize size)
+{
+    switch (size)
+    {
+        case ModelSize::hidden8:  return 8;
+        case ModelSize::hidden16: return 16;
+        case ModelSize::hidden24: return 24;
+        case ModelSize::hidden32: return 32;
+    }
+
+    return 16;
+}
+
+inline bool getModelSize (int hiddenSize, ModelSize& size)
+{
+    for (int i = 0; i < numModelSizes; ++i)
+    {
+        if (getHiddenSize ((ModelSize) i) == hiddenSize)
+        {
+            size = (ModelSize) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Calls fn with the hidden size of `size` as a compile-time constant.
+template <typename Fn>
+auto withHiddenSize (ModelSize size, Fn&& fn)
+{
+    switch (size)
+    {
+        case ModelSize::hidden8:  return fn (std::integral_constant<int, 8>());
+        case ModelSize::hidden24: return fn (std::integral_constant<int, 24>());
+        case ModelSize::hidden32: return fn (std::integral_constant<int, 32>());
+        case ModelSize::hidden16: break;
+    }
+
+    return fn (std::integral_constant<int, 16>());
+}
+
+template <int hiddenSize>
+void loadDistModel (const nlohmann::json& modelJson, DistModelT<hiddenSize>& model)
+{
+    // the python side names its layers "lstm" and "dense" (see SimpleLSTM)
+    auto& lstm = model.template get<0>();
+    RTNeural::torch_helpers::loadLSTM<float> (modelJson, "lstm.", lstm);
+
+    auto& dense = model.template get<1>();
+    RTNeural::torch_helpers::loadDense<float> (modelJson, "dense.", dense);
+
+    model.reset();
+}
+
+template <int hiddenSize>
+void loadDistModel (const nlohmann::json& modelJson, DistGRUModelT<hiddenSize>& model)
+{
+    // SimpleGRU names its layers "gru" and "dense"
+    auto& gru = model.template get<0>();
+    RTNeural::torch_helpers::loadGRU<float> (modelJson, "gru.", gru);
+
+    auto& dense = model.template get<1>();
+    RTNeural::torch_helpers::loadDense<float> (modelJson, "dense.", dense);
+
+    model.reset();
+}
+
+// Reads the PyTorch state dict keys written by SimpleLSTM.save_for_rtneural.
+template <int hiddenSize>
+std::shared_ptr<DistWeights<hiddenSize>> loadDistWeights (const nlohmann::json& modelJson)
+{
+    constexpr int numGates = 4 * hiddenSize;
+
+    for (auto* key : { "lstm.weight_ih_l0", "lstm.weight_hh_l0", "lstm.bias_ih_l0", "lstm.bias_hh_l0", "dense.weight", "dense.bias" })
+        if (! modelJson.contains (key) || ! modelJson[key].is_array())
+            return nullptr;
+
+    const auto& weightIh = modelJson["lstm.weight_ih_l0"];
+    const auto& weightHh = modelJson["lstm.weight_hh_l0"];
+    const auto& biasIh = modelJson["lstm.bias_ih_l0"];
+    const auto& biasHh = modelJson["lstm.bias_hh_l0"];
+    const auto& denseWeight = modelJson["dense.weight"];
+    const auto& denseBias = modelJson["dense.bias"];
+
+    if ((int) weightIh.size() != numGates || (int) weightHh.size() != numGates
+        || (int) biasIh.size() != numGates || (int) biasHh.size() != numGates
+        || denseWeight.size() != 1 || (int) denseWeight[0].size() != hiddenSize || denseBias.size() != 1)
+        return nullptr;
+
+    auto weights = std::make_shared<DistWeights<hiddenSize>>();
+
+    for (int k = 0; k < numGates; ++k)
+    {
+        if (weightIh[k].size() != 2 || (int) weightHh[k].size() != hiddenSize)
+            return nullptr;
+
+        weights->inputWeights[k] = weightIh[k][0].get<float>();
+        weights->conditionWeights[k] = weightIh[k][1].get<float>();
+        weights->bias[k] = biasIh[k].get<float>() + biasHh[k].get<float>();
+
+        for (int j = 0; j < hiddenSize; ++j)
+            weights->recurrentWeights[j][k] = weightHh[k][j].get<float>();
+    }
+
+    for (int i = 0; i < hiddenSize; ++i)
+        weights->denseWeights[i] = denseWeight[0][i].get<float>();
+
+    weights->denseBias = denseBias[0].get<float>();
+    return weights;
+}
+
+// Reads the PyTorch state dict keys written by SimpleGRU.save_for_rtneural.
+template <int hiddenSize>
+std::shared_ptr<DistGRUWeights<hiddenSize>> loadDistGRUWeights (const nlohmann::json& modelJson)
+{
+    constexpr int numGates = 3 * hiddenSize;
+
+    for (auto* key : { "gru.weight_ih_l0", "gru.weight_hh_l0", "gru.bias_ih_l0", "gru.bias_hh_l0", "dense.weight", "dense.bias" })
+        if (! modelJson.contains (key) || ! modelJson[key].is_array())
+            return nullptr;
+
+    const auto& weightIh = modelJson["gru.weight_ih_l0"];
+    const auto& weightHh = modelJson["gru.weight_hh_l0"];
+    const auto& biasIh = modelJson["gru.bias_ih_l0"];
+    const auto& biasHh = modelJson["gru.bias_hh_l0"];
+    const auto& denseWeight = modelJson["dense.weight"];
+    const auto& denseBias = modelJson["dense.bias"];
+
+    if ((int) weightIh.size() != numGates || (int) weightHh.size() != numGates
+        || (int) biasIh.size() != numGates || (int) biasHh.size() != numGates
+        || denseWeight.size() != 1 || (int) denseWeight[0].size() != hiddenSize || denseBias.size() != 1)
+        return nullptr;
+
+    auto weights = std::make_shared<DistGRUWeights<hiddenSize>>();
+
+    for (int k = 0; k < numGates; ++k)
+    {
+        if (weightIh[k].size() != 2 || (int) weightHh[k].size() != hiddenSize)
+            return nullptr;
+
+        weights->inputWeights[k] = weightIh[k][0].get<float>();
+        weights->conditionWeights[k] = weightIh[k][1].get<float>();
+
+        // the new gate's bias_hh sits inside the reset gate's product
+        if (k < 2 * hiddenSize)
+            weights->bias[k] = biasIh[k].get<float>() + biasHh[k].get<float>();
+        else
+            weights->bias[k] = biasIh[k].get<float>();
+
+        for (int j = 0; j < hiddenSize; ++j)
+            weights->recurrentWeights[j][k] = weightHh[k][j].get<float>();
+    }
+
+    for (int i = 0; i < hiddenSize; ++i)
+    {
+        weights->newGateBias[i] = biasHh[2 * hiddenSize + i].get<float>();
+        weights->denseWeights[i] = denseWeight[0][i].get<float>();
+    }
+
+    weights->denseBias = denseBias[0].get<float>();
+    return weights;
+}
+
+template <int hiddenSize>
+std::unique_ptr<DistModelVariant> makeDistModel (std::shared_ptr<const DistWeights<hiddenSize>> weights)
+{
+    if (weights == nullptr)
+        return nullptr;
+
+    return std::make_unique<DistModelVariant> (std::in_place_type<DistLSTM<hiddenSize>>, std::move (weights));
+}
+
+template <int hiddenSize>
+std::unique_ptr<DistModelVariant> makeDistModel (std::shared_ptr<const DistQuantizedWeights<hiddenSize>> weights)
+{
+    if (weights == nullptr)
+        return nullptr;
+
+    return std::make_unique<DistModelVariant> (std::in_place_type<DistQuantizedLSTM<hiddenSize>>, std::move (weights));
+}
+
+#if DISTNN_GRU
+template <int hiddenSize>
+std::unique_ptr<DistModelVariant> makeDistModel (std::shared_ptr<const DistGRUWeights<hiddenSize>> weights)
+{
+    if (weights == nullptr)
+        return nullptr;
+
+    return std::make_unique<DistModelVariant> (std::in_place_type<DistGRU<hiddenSize>>, std::move (weights));
+}
+#endif
+
+// Picks the specialization from the hidden size stored in the file itself, or
+// the dynamic engine when no specialization has that size. GRU models must be
+// one of the compiled sizes.
+inline std::unique_ptr<DistModelVariant> makeDistModel (const nlohmann::json& modelJson)
+{
+    if (modelJson.contains ("gru.weight_ih_l0"))
+    {
+       #if DISTNN_GRU
+        ModelSize size;
+
+        if (! modelJson["gru.weight_ih_l0"].is_array() || ! getModelSize ((int) modelJson["gru.weight_ih_l0"].size() / 3, size))
+            return nullptr;
+
+        return withHiddenSize (size, [&] (auto staticHiddenSize)
+        {
+            return makeDistModel<staticHiddenSize> (loadDistGRUWeights<staticHiddenSize> (modelJson));
+        });
+       #else
+        return nullptr;
+       #endif
+    }
+
+    const auto hiddenSize = DistDynamicLSTM::getHiddenSize (modelJson);
+    ModelSize size;
+
+    if (hiddenSize == 0)
+        return nullptr;
+
+    if (! getModelSize (hiddenSize, size))
+        return std::make_unique<DistModelVariant> (std::in_place_type<DistDynamicLSTM>, std::make_shared<const nlohmann::json> (modelJson));
+
+    return withHiddenSize (size, [&] (auto staticHiddenSize)
+    {
+        return makeDistModel<staticHiddenSize> (loadDistWeights<staticHiddenSize> (modelJson));
+    });
+}
+
+// Loads a model from either a binary .dnnb file or the JSON exported by
+// SimpleLSTM.save_for_rtneural, and builds the specialization matching its
+// hidden size. Binary files are used in place when aligned; `owner` must keep
+// `data` alive in that case (nullptr for static data such as BinaryData).
+// Returns nullptr for anything that is not a DIST-NN model; .dnnb files and GRU
+// models must be one of the compiled sizes (8/16/24/32), LSTM JSON ones can
+// have any hidden size.
+// Always parses; makeDistModel below goes through the shared weight cache first.
+inline std::unique_ptr<DistModelVariant> parseDistModel (const char* data, size_t size,
+                                                         std::shared_ptr<const void> owner = nullptr)
+{
+    if (isDistModelFile (data, size))
+    {
+        DistModelFileHeader header;
+        ModelSize modelSize;
+
+        if (! readDistModelHeader (data, size, header) || ! getModelSize ((int) header.hiddenSize, modelSize))
+            return nullptr;
+
+        // the cell type and precision flags in the header pick the engine
+        return withHiddenSize (modelSize, [&] (auto hiddenSize)
+        {
+            if (header.cellType == DistModelFileHeader::gru)
+            {
+               #if DISTNN_GRU
+                return makeDistModel<hiddenSize> (readDistGRUWeights<hiddenSize> (data, size, std::move (owner)));
+               #else
+                return std::unique_ptr<DistModelVariant>();
+               #endif
+            }
+
+            if (header.precision == DistModelFileHeader::int8)
+                return makeDistModel<hiddenSize> (readDistQuantizedWeights<hiddenSize> (data, size, std::move (owner)));
+
+            return makeDistModel<hiddenSize> (readDistWeights<hiddenSize> (data, size, std::move (owner)));
+        });
+    }
+
+    try
+    {
+        return makeDistModel (nlohmann::json::parse (data, data + size));
+    }
+    catch (const nlohmann::json::exception&)
+    {
+    }
+
+    return nullptr;
+}
+
+// Builds the engine alternative at `index` around type-erased weights from the cache.
+template <size_t index = 0>
+std::unique_ptr<DistModelVariant> makeDistModelAt (size_t engineIndex, const std::shared_ptr<const void>& weights)
+{
+    if constexpr (index < std::variant_size_v<DistModelVariant>)
+    {
+        using Engine = std::variant_alternative_t<index, DistModelVariant>;
+
+        // shared engines wrap another engine's weights and are never cached themselves
+        if constexpr (std::is_same_v<Engine, DistSharedLSTM>)
+            return nullptr;
+        else if (engineIndex == index)
+            return std::make_unique<DistModelVariant> (std::in_place_index<index>,
+                                                       std::static_pointer_cast<const typename Engine::Weights> (weights));
+
+        return makeDistModelAt<index + 1> (engineIndex, weights);
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+// Same as parseDistModel, but instances loading identical model data share one
+// read-only copy of the weights through DistWeightCache; only the first load
+// parses anything. Allocates and may lock, so never call this from the audio thread.
+inline std::unique_ptr<DistModelVariant> makeDistModel (const char* data, size_t size,
+                                                        std::shared_ptr<const void> owner = nullptr)
+{
+    const auto entry = DistWeightCache::getInstance().getOrLoad (hashDistModelData (data, size), data, size, [&]
+    {
+        DistWeightCache::Entry loaded;
+
+        if (auto model = parseDistModel (data, size, std::move (owner)))
+        {
+            loaded.engineIndex = model->index();
+            loaded.weights = std::visit ([] (auto& engine) { return std::shared_ptr<const void> (engine.getSharedWeights()); }, *model);
+        }
+
+        return loaded;
+    });
+
+    if (entry.weights == nullptr)
+        return nullptr;
+
+    return makeDistModelAt (entry.engineIndex, entry.weights);
+}
+
+// One engine per channel pair, for buses wider than stereo. The engines share the
+// prototype's weights and only own their LSTM state.
+using DistModelBank = std::vector<DistModelVariant>;
+
+inline std::unique_ptr<DistModelBank> makeDistModelBank (const DistModelVariant& prototype, int numEngines)
+{
+    return std::make_unique<DistModelBank> ((size_t) std::max (1, numEngines), prototype);
+}
+
+// Same as makeDistModelBank, with engines that run through the process-wide
+// DistBatchHub of the prototype's weights, batched with the engines of every other
+// instance on the same model (see DistSharedLSTM.h). hopSize should be the
+// largest block the engines get; their output is two hops late. The dynamic
+// and GRU engines have no batched kernel, and a hub without room for the whole bank would
+// leave pairs at different latencies: both get a plain bank instead, see
+// getDistModelBankLatency.
+inline std::unique_ptr<DistModelBank> makeDistSharedModelBank (const DistModelVariant& prototype, int numEngines, int hopSize)
+{
+    auto hub = std::visit ([] (const auto& engine) -> std::shared_ptr<DistBatchHub>
+    {
+        using Engine = std::decay_t<decltype (engine)>;
+
+        if constexpr (std::is_same_v<Engine, DistSharedLSTM>)
+            return engine.getHub();
+        else if constexpr (std::is_same_v<Engine, DistDynamicLSTM> || isDistGRU<Engine>)
+            return nullptr;
+        else
+            return getDistBatchHub (engine.getSharedWeights());
+    }, prototype);
+
+    if (hub == nullptr)
+        return makeDistModelBank (prototype, numEngines);
+
+    auto bank = std::make_unique<DistModelBank>();
+    bank->reserve ((size_t) std::max (1, numEngines));
+
+    for (int i = 0; i < std::max (1, numEngines); ++i)
+    {
+        bank->emplace_back (std::in_place_type<DistSharedLSTM>, hub, hopSize);
+
+        if (! std::get<DistSharedLSTM> (bank->back()).isValid())
+            return makeDistModelBank (prototype, numEngines);
+    }
+
+    return bank;
+}
+
+// Samples the bank's output lags its input by, at the rate it runs at.
+inline int getDistModelBankLatency (const DistModelBank& bank)
+{
+    if (bank.empty() || ! std::holds_alternative<DistSharedLSTM> (bank.front()))
+        return 0;
+
+    return std::get<DistSharedLSTM> (bank.front()).getLatencySamples();
+}
+
+// Resets the bank and settles it on silence at `effect`, the state playback
+// starts from, so the first block does not play the transient out of a zero
+// state. Every engine runs until silence skipping lets it go idle (or for at
+// most maxSamples, about 0.2 s); once idle, the first silent blocks cost
+// nothing. Does not allocate, but it runs the model: keep it off the audio thread.
+inline void prewarmDistModelBank (DistModelBank& bank, float effect, int maxSamples = 8192)
+{
+    // shared engines only run their own hops here, other instances' audio must not wait on this thread
+    const DistBatchHub::ScopedSoloProcessing solo;
+
+    for (auto& engineVariant : bank)
+    {
+        std::visit ([&] (auto& engine)
+        {
+            constexpr int blockSize = 64;
+            float left[blockSize], right[blockSize];
+            float* channels[] = { left, right };
+
+            engine.reset();
+
+            for (int done = 0; done < maxSamples && ! engine.isIdle(); done += blockSize)
+            {
+                std::fill (std::begin (left), std::end (left), 0.0f);
+                std::fill (std::begin (right), std::end (right), 0.0f);
+                engine.process (channels, 2, blockSize, effect);
+            }
+        }, engineVariant);
+    }
+}
+
+#endif /* DistModels_h */
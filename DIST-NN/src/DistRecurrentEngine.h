@@ -0,0 +1,347 @@
+#ifndef DistRecurrentEngine_h
+#define DistRecurrentEngine_h
+
+#include "DistActivations.h"
+
+#include <cmath>
+#include <memory>
+
+// What DistLSTM and DistGRU have in common: `numLanes` independent channels
+// through the same recurrent layer and Dense output, each lane with its own
+// state, the effect folded into the gate bias and gliding over the smoothing
+// length, processing in sub-blocks, silence skipping and the activation tiers.
+//
+// The cell itself comes from Derived (CRTP), which provides
+//   template <typename Activations>
+//   float updateState (float (&inputPart)[numLanes][numGates]) noexcept
+// to advance every lane by one sample from the input projection (bias, effect
+// and audio input of every gate, which it may overwrite) and return the largest
+// change of any state value, and
+//   void resetState() noexcept
+// to clear whatever state it keeps besides `hidden`. WeightsType needs the
+// inputWeights, conditionWeights, bias, denseWeights and denseBias members of
+// DistWeights.
+//
+// process() skips the recurrence on silence: once every lane's input has stayed
+// below silenceThreshold long enough for the state to stop moving, the output is
+// held at the settled value without running any inference. The state is left
+// exactly where it settled, so processing resumes seamlessly on the next
+// non-silent sample. A knob change during silence wakes the engine up until it
+// settles again.
+template <typename Derived, int hiddenSize, int numLanes, typename WeightsType>
+class DistRecurrentEngine
+{
+public:
+    using Weights = WeightsType;
+    static constexpr int numGates = Weights::numGates;
+
+    static constexpr float silenceThreshold = 1.0e-5f;  // about -100 dBFS
+    static constexpr float settledThreshold = 1.0e-6f;  // largest state change per sample
+    static constexpr int samplesToSettle = 32;
+
+    void reset() noexcept
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+            for (int i = 0; i < hiddenSize; ++i)
+                hidden[lane][i] = 0.0f;
+
+        static_cast<Derived&> (*this).resetState();
+
+        // after a reset there is no previous knob position to glide from
+        snapToEffect = true;
+        wake();
+    }
+
+    // Sets the conditioning ("effect") value. The effect column of weight_ih is folded
+    // into the gate bias, so the per-sample recurrence only sees the audio input.
+    // Changes glide over the smoothing length instead of jumping, which would zipper.
+    void setEffect (float newEffect) noexcept
+    {
+        if (snapToEffect)
+        {
+            snapToEffect = false;
+            effectSamplesLeft = 0;
+            currentEffect = targetEffect = newEffect;
+            updateConditionedBias();
+        }
+        else if (newEffect != targetEffect)
+        {
+            targetEffect = newEffect;
+            effectSamplesLeft = smoothingLength;
+            effectIncrement = (targetEffect - currentEffect) / (float) smoothingLength;
+
+            // the settled output depends on the effect value
+            wake();
+        }
+    }
+
+    void setSilenceSkipping (bool shouldSkip) noexcept
+    {
+        skipSilence = shouldSkip;
+        wake();
+    }
+
+    // Gate activation tier (see DistActivations.h). Only the approximation error
+    // changes, so it can be switched between blocks without a reset.
+    void setActivationQuality (ActivationQuality newQuality) noexcept { activationQuality = newQuality; }
+    ActivationQuality getActivationQuality() const noexcept { return activationQuality; }
+
+    // True while process() is holding the settled output instead of running the recurrence.
+    bool isIdle() const noexcept { return idle; }
+
+    void setSmoothingLength (int numSamples) noexcept
+    {
+        smoothingLength = numSamples > 0 ? numSamples : 1;
+    }
+
+    // Advances every lane by one sample.
+    void step (const float (&input)[numLanes], float (&output)[numLanes]) noexcept
+    {
+        const auto& w = *weights;
+        auto& inputPart = projected[0];
+
+        if (effectSamplesLeft > 0)
+        {
+            // knob is moving: apply the full effect column for the interpolated value
+            currentEffect += effectIncrement;
+
+            if (--effectSamplesLeft == 0)
+            {
+                currentEffect = targetEffect;
+                updateConditionedBias();
+            }
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                for (int k = 0; k < numGates; ++k)
+                    inputPart[lane][k] = w.bias[k] + w.conditionWeights[k] * currentEffect + w.inputWeights[k] * input[lane];
+        }
+        else
+        {
+            for (int lane = 0; lane < numLanes; ++lane)
+                for (int k = 0; k < numGates; ++k)
+                    inputPart[lane][k] = conditionedBias[k] + w.inputWeights[k] * input[lane];
+        }
+
+        stateChange = updateState (inputPart);
+
+        for (int lane = 0; lane < numLanes; ++lane)
+            output[lane] = computeOutput (hidden[lane]);
+    }
+
+    // Processes up to numLanes channels in place. Lanes without a channel are fed silence.
+    //
+    // Works in sub-blocks of subBlockSize samples: the input projection of the
+    // whole sub-block is computed in one pass, only the recurrence and the
+    // activations run sample by sample, and the Dense layer is applied to the
+    // stored hidden states in a final pass, which keeps the serial dependency chain
+    // as short as possible. While the effect is gliding it falls back to step().
+    void process (float* const* channels, int numChannels, int numSamples, float effect) noexcept
+    {
+        setEffect (effect);
+        numChannels = numChannels < numLanes ? numChannels : numLanes;
+
+        for (int start = 0; start < numSamples; start += subBlockSize)
+        {
+            const auto numInSubBlock = numSamples - start < subBlockSize ? numSamples - start : subBlockSize;
+
+            if (effectSamplesLeft > 0)
+                processSamples (channels, numChannels, start, numInSubBlock);
+            else
+                processSubBlock (channels, numChannels, start, numInSubBlock);
+        }
+    }
+
+    const Weights& getWeights() const noexcept { return *weights; }
+    const std::shared_ptr<const Weights>& getSharedWeights() const noexcept { return weights; }
+
+protected:
+    // Derived calls reset() once its own members exist.
+    explicit DistRecurrentEngine (std::shared_ptr<const Weights> modelWeights)
+        : weights (std::move (modelWeights))
+    {
+        updateConditionedBias();
+    }
+
+    std::shared_ptr<const Weights> weights;
+    alignas (32) float hidden[numLanes][hiddenSize];
+
+private:
+    static constexpr int subBlockSize = 16;
+
+    void wake() noexcept
+    {
+        idle = false;
+        settledSamples = 0;
+    }
+
+    float updateState (float (&inputPart)[numLanes][numGates]) noexcept
+    {
+        auto& cell = static_cast<Derived&> (*this);
+
+        switch (activationQuality)
+        {
+            case ActivationQuality::high:   return cell.template updateState<HighActivations> (inputPart);
+            case ActivationQuality::medium: return cell.template updateState<MediumActivations> (inputPart);
+            case ActivationQuality::fast:   return cell.template updateState<FastActivations> (inputPart);
+            case ActivationQuality::exact:  break;
+        }
+
+        return cell.template updateState<ExactActivations> (inputPart);
+    }
+
+    float computeOutput (const float (&state)[hiddenSize]) const noexcept
+    {
+        const auto& w = *weights;
+        float y = w.denseBias;
+
+        for (int i = 0; i < hiddenSize; ++i)
+            y += w.denseWeights[i] * state[i];
+
+        return y;
+    }
+
+    // Counts how long the state has been still on silent input, and goes idle once it has settled.
+    void updateSettled (bool silent, const float (&output)[numLanes]) noexcept
+    {
+        settledSamples = silent && effectSamplesLeft == 0 && stateChange < settledThreshold ? settledSamples + 1 : 0;
+
+        if (settledSamples >= samplesToSettle)
+        {
+            idle = true;
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                settledOutput[lane] = output[lane];
+        }
+    }
+
+    // One step() per sample, used while the effect glides.
+    void processSamples (float* const* channels, int numChannels, int start, int numSamples) noexcept
+    {
+        for (int n = start; n < start + numSamples; ++n)
+        {
+            float x[numLanes] {};
+            float y[numLanes];
+            bool silent = skipSilence;
+
+            for (int lane = 0; lane < numChannels; ++lane)
+            {
+                x[lane] = channels[lane][n];
+                silent = silent && std::fabs (x[lane]) < silenceThreshold;
+            }
+
+            if (silent && idle)
+            {
+                for (int lane = 0; lane < numChannels; ++lane)
+                    channels[lane][n] = settledOutput[lane];
+
+                continue;
+            }
+
+            idle = false;
+            step (x, y);
+
+            for (int lane = 0; lane < numChannels; ++lane)
+                channels[lane][n] = y[lane];
+
+            updateSettled (silent, y);
+        }
+    }
+
+    void processSubBlock (float* const* channels, int numChannels, int start, int numSamples) noexcept
+    {
+        const auto& w = *weights;
+        bool silent[subBlockSize];
+        bool allSilent = true;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            silent[n] = skipSilence;
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                const auto x = lane < numChannels ? channels[lane][start + n] : 0.0f;
+                silent[n] = silent[n] && std::fabs (x) < silenceThreshold;
+
+                // input projection of the whole sub-block, no dependency between samples
+                for (int k = 0; k < numGates; ++k)
+                    projected[n][lane][k] = conditionedBias[k] + w.inputWeights[k] * x;
+            }
+
+            allSilent = allSilent && silent[n];
+        }
+
+        if (allSilent && idle)
+        {
+            for (int lane = 0; lane < numChannels; ++lane)
+                for (int n = 0; n < numSamples; ++n)
+                    channels[lane][start + n] = settledOutput[lane];
+
+            return;
+        }
+
+        idle = false;
+        bool becameIdle = false;
+
+        // the serial part: recurrence and activations only
+        for (int n = 0; n < numSamples; ++n)
+        {
+            stateChange = updateState (projected[n]);
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                for (int i = 0; i < hiddenSize; ++i)
+                    hiddenHistory[n][lane][i] = hidden[lane][i];
+
+            settledSamples = silent[n] && stateChange < settledThreshold ? settledSamples + 1 : 0;
+            becameIdle = becameIdle || settledSamples >= samplesToSettle;
+        }
+
+        // Dense layer over the stored hidden states
+        float y[numLanes] {};
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                y[lane] = computeOutput (hiddenHistory[n][lane]);
+
+                if (lane < numChannels)
+                    channels[lane][start + n] = y[lane];
+            }
+        }
+
+        // held from the next all-silent sub-block on
+        if (becameIdle && settledSamples >= samplesToSettle)
+        {
+            idle = true;
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                settledOutput[lane] = y[lane];
+        }
+    }
+
+    void updateConditionedBias() noexcept
+    {
+        const auto& w = *weights;
+
+        for (int k = 0; k < numGates; ++k)
+            conditionedBias[k] = w.bias[k] + w.conditionWeights[k] * currentEffect;
+    }
+
+    alignas (32) float conditionedBias[numGates];
+    alignas (32) float projected[subBlockSize][numLanes][numGates];
+    alignas (32) float hiddenHistory[subBlockSize][numLanes][hiddenSize];
+
+    float currentEffect = 0.0f, targetEffect = 0.0f, effectIncrement = 0.0f;
+    int effectSamplesLeft = 0;
+    int smoothingLength = 256;
+    bool snapToEffect = true;
+
+    float settledOutput[numLanes] {};
+    float stateChange = 0.0f;
+    int settledSamples = 0;
+    bool skipSilence = true, idle = false;
+
+    ActivationQuality activationQuality = defaultActivationQuality;
+};
+
+#endif /* DistRecurrentEngine_h */
@@ -0,0 +1,727 @@
+#ifndef DistSharedLSTM_h
+#define DistSharedLSTM_h
+
+#include "DistLSTM.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Cross-instance batching for sessions with many instances on the same model.
+//
+// A DistBatchHub exists once per set of weights in the process, and every
+// DistSharedLSTM built on those weights (every channel pair of every plugin
+// instance) owns one of its slots. Instead of stepping its own two lanes, an
+// engine hands the hub one hop of input at a time. Whichever audio thread
+// first needs a result gathers all the hops submitted so far into one matrix of
+// up to 64 lanes and advances them together: every weight is loaded once per
+// sample for all of them, and the loops run over contiguous lanes at full SIMD
+// width. The results and states are scattered back, and every engine picks its
+// output up at its next hop.
+//
+// The hop is the host block size, so that each instance submits once per block
+// and the hops of all instances meet in one batch; an engine reads back the hop
+// it submitted one hop earlier, so its output is two hops late. Only hops of the
+// same length are batched together.
+//
+// A thread only batches the jobs that were submitted from the same thread as
+// its own, i.e. the instances the host runs on that thread. Hosts that spread
+// instances over several audio threads keep that parallelism, and each thread
+// gets the batching gain on its own share; a host that runs everything on one
+// thread gets a single batch. The gain comes from the cheaper activations,
+// where the weight loads dominate: with the Exact tier the time goes into the
+// activations themselves, which batching does not make faster.
+class DistBatchHub
+{
+public:
+    static constexpr int maxSlots = 128;        // channel pairs per model, all instances together
+    static constexpr int maxBatchSlots = 32;    // two lanes each
+    static constexpr int maxLanes = 2 * maxBatchSlots;
+    static constexpr int maxConcurrentBatches = 8;  // audio threads running batches at the same time
+
+    // One engine's job, written by its owner between finish() and submit().
+    // hopSize and submitter are atomic because other threads look at them to
+    // decide whether to claim the job.
+    struct Slot
+    {
+        const float* input[2] {};
+        float* output[2] {};
+        float effect = 0.0f;         // reached by the end of the hop, ramping from the previous one
+        ActivationQuality activationQuality = defaultActivationQuality;
+        bool resetState = false;     // zero the state and snap the effect before this hop
+
+        std::atomic<int> hopSize { 0 };
+        std::atomic<const void*> submitter { nullptr };
+        std::atomic<int> state { 0 };
+    };
+
+    virtual ~DistBatchHub() = default;
+
+    // Slots are taken and given back on the message or loader thread; -1 when all are in use.
+    int acquireSlot (int hopSize) noexcept
+    {
+        for (int i = 0; i < maxSlots; ++i)
+        {
+            int expected = unused;
+
+            if (slots[i].state.compare_exchange_strong (expected, idle, std::memory_order_acquire))
+            {
+                slots[i].hopSize.store (hopSize, std::memory_order_relaxed);
+
+                // the batch scans only go up to the highest slot ever used
+                auto used = numSlotsUsed.load (std::memory_order_relaxed);
+
+                while (used < i + 1 && ! numSlotsUsed.compare_exchange_weak (used, i + 1, std::memory_order_release))
+                {
+                }
+
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void releaseSlot (int slot) noexcept { slots[slot].state.store (unused, std::memory_order_release); }
+
+    Slot& getSlot (int slot) noexcept { return slots[slot]; }
+
+    void submit (int slot) noexcept
+    {
+        slots[slot].submitter.store (getThreadToken(), std::memory_order_relaxed);
+        slots[slot].state.store (submitted, std::memory_order_release);
+    }
+
+    // Returns once the job submitted on `slot` has run, running it now if nobody
+    // has picked it up yet: together with the other pending jobs of the same hop
+    // size that were submitted from the same thread when batchWithOthers is set,
+    // or on its own. When every scratch set is taken by other threads' batches,
+    // the job runs on its own in the slot's fallback buffers rather than waiting.
+    void finish (int slot, bool batchWithOthers) noexcept
+    {
+        auto& owned = slots[slot];
+
+        if (claim (slot, owned.hopSize.load (std::memory_order_relaxed), nullptr))
+        {
+            const ScopedScratch scratch (*this);
+
+            if (batchWithOthers && scratch.index >= 0)
+                runPendingJobs (slot, scratch.index);
+            else
+                runJobs (&slot, 1, scratch.index);
+        }
+
+        // Claimed by another thread's batch, which runs it before it lets go of
+        // any slot: this waits for at most that one batch, i.e. maxBatchSlots
+        // hops of the same size.
+        while (owned.state.load (std::memory_order_acquire) == running)
+            std::this_thread::yield();
+
+        owned.state.store (idle, std::memory_order_relaxed);
+    }
+
+    // While one of these is in scope, engines on this thread only run their own
+    // jobs. Background threads use it, so that no audio thread ends up waiting
+    // for them to get through a batch.
+    struct ScopedSoloProcessing
+    {
+        ScopedSoloProcessing() noexcept : wasSolo (solo()) { solo() = true; }
+        ~ScopedSoloProcessing() { solo() = wasSolo; }
+
+        const bool wasSolo;
+    };
+
+    static bool isSoloProcessing() noexcept { return solo(); }
+
+    virtual std::shared_ptr<const void> getSharedWeights() const noexcept = 0;
+
+protected:
+    // Advances the listed slots by one hop (all of the same size). Batches run
+    // concurrently on disjoint slots, each with scratch buffer `scratchIndex`;
+    // -1 runs a single slot in buffers of its own.
+    virtual void runBatch (const int* batchSlots, int numBatchSlots, int hopSize, int scratchIndex) noexcept = 0;
+
+private:
+    enum { unused = 0, idle, submitted, running, done };
+
+    static bool& solo() noexcept
+    {
+        static thread_local bool isSolo = false;
+        return isSolo;
+    }
+
+    static const void* getThreadToken() noexcept
+    {
+        static thread_local char token;
+        return &token;
+    }
+
+    // takes one of the kernel's buffer sets for a batch; index is -1 when more
+    // than maxConcurrentBatches threads are batching at once
+    struct ScopedScratch
+    {
+        explicit ScopedScratch (DistBatchHub& h) noexcept : hub (h)
+        {
+            for (index = 0; index < maxConcurrentBatches; ++index)
+                if (! hub.scratchInUse[index].exchange (true, std::memory_order_acquire))
+                    return;
+
+            index = -1;
+        }
+
+        ~ScopedScratch()
+        {
+            if (index >= 0)
+                hub.scratchInUse[index].store (false, std::memory_order_release);
+        }
+
+        DistBatchHub& hub;
+        int index = 0;
+    };
+
+    // Takes a submitted job for the caller to run; nullptr takes it from any
+    // thread. The job is checked before it is taken, and a taken job is always
+    // run: its owner's finish() waits for `running` to end.
+    bool claim (int slot, int hopSize, const void* submitter) noexcept
+    {
+        auto& job = slots[slot];
+
+        if (job.state.load (std::memory_order_acquire) != submitted
+             || job.hopSize.load (std::memory_order_relaxed) != hopSize
+             || (submitter != nullptr && job.submitter.load (std::memory_order_relaxed) != submitter))
+            return false;
+
+        int expected = submitted;
+        return job.state.compare_exchange_strong (expected, running, std::memory_order_acquire);
+    }
+
+    // `ownSlot` is claimed already; joins it with the pending jobs of the thread that submitted it
+    void runPendingJobs (int ownSlot, int scratchIndex) noexcept
+    {
+        int batch[maxBatchSlots];
+        int numInBatch = 0;
+        const auto hopSize = slots[ownSlot].hopSize.load (std::memory_order_relaxed);
+        const auto* submitter = slots[ownSlot].submitter.load (std::memory_order_relaxed);
+        const auto numUsed = numSlotsUsed.load (std::memory_order_acquire);
+
+        batch[numInBatch++] = ownSlot;
+
+        for (int i = 0; i < numUsed; ++i)
+        {
+            if (i != ownSlot && claim (i, hopSize, submitter))
+            {
+                // given to a new engine with another hop size between the check and
+                // the claim: still ours to run, but not in this batch
+                if (slots[i].hopSize.load (std::memory_order_relaxed) != hopSize)
+                {
+                    runJobs (&i, 1, scratchIndex);
+                    continue;
+                }
+
+                batch[numInBatch++] = i;
+
+                if (numInBatch == maxBatchSlots)
+                {
+                    runJobs (batch, numInBatch, scratchIndex);
+                    numInBatch = 0;
+                }
+            }
+        }
+
+        if (numInBatch > 0)
+            runJobs (batch, numInBatch, scratchIndex);
+    }
+
+    void runJobs (const int* batchSlots, int numBatchSlots, int scratchIndex) noexcept
+    {
+        runBatch (batchSlots, numBatchSlots, slots[batchSlots[0]].hopSize.load (std::memory_order_relaxed), scratchIndex);
+
+        for (int i = 0; i < numBatchSlots; ++i)
+            slots[batchSlots[i]].state.store (done, std::memory_order_release);
+    }
+
+    Slot slots[maxSlots];
+    std::atomic<int> numSlotsUsed { 0 };
+    std::atomic<bool> scratchInUse[maxConcurrentBatches] {};
+};
+
+// The batched kernel for DistLSTM's weight types. Everything is lane-minor
+// ([row][lane]), so each weight is broadcast against a contiguous run of lanes.
+// Results agree with DistLSTM and DistQuantizedLSTM to float rounding, not bit
+// for bit: the sums run in another order, and int8 weights are scaled one by
+// one rather than once per gate sum. A batch runs at the most accurate tier
+// any of its engines asks for, see runBatch.
+template <int hiddenSize, typename WeightsType>
+class DistBatchHubT final : public DistBatchHub
+{
+public:
+    using Weights = WeightsType;
+    static constexpr int numGates = Weights::numGates;
+
+    explicit DistBatchHubT (std::shared_ptr<const Weights> modelWeights)
+        : weights (std::move (modelWeights)),
+          scratch (std::make_unique<Scratch[]> (maxConcurrentBatches)),
+          fallbackLanes (std::make_unique<Lanes<2>[]> (maxSlots))
+    {
+    }
+
+    std::shared_ptr<const void> getSharedWeights() const noexcept override { return weights; }
+
+private:
+    static float getRecurrentWeight (const DistWeights<hiddenSize>& w, int j, int k) noexcept
+    {
+        return w.recurrentWeights[j][k];
+    }
+
+    static float getRecurrentWeight (const DistQuantizedWeights<hiddenSize>& w, int j, int k) noexcept
+    {
+        return (float) w.recurrentWeights[j][k] * w.recurrentScales[k];
+    }
+
+    void runBatch (const int* batchSlots, int numBatchSlots, int hopSize, int scratchIndex) noexcept override
+    {
+        // the most accurate tier any of the engines asks for
+        auto quality = ActivationQuality::fast;
+
+        for (int b = 0; b < numBatchSlots; ++b)
+            quality = std::min (quality, getSlot (batchSlots[b]).activationQuality);
+
+        switch (quality)
+        {
+            case ActivationQuality::high:   runWidth<HighActivations> (scratchIndex, batchSlots, numBatchSlots, hopSize); return;
+            case ActivationQuality::medium: runWidth<MediumActivations> (scratchIndex, batchSlots, numBatchSlots, hopSize); return;
+            case ActivationQuality::fast:   runWidth<FastActivations> (scratchIndex, batchSlots, numBatchSlots, hopSize); return;
+            case ActivationQuality::exact:  break;
+        }
+
+        runWidth<ExactActivations> (scratchIndex, batchSlots, numBatchSlots, hopSize);
+    }
+
+    // Fixed widths keep the lane loops at a constant trip count. Batches of up
+    // to a dozen engines go through in groups of at most 8 lanes rather than
+    // wasting most of a wide pass on padding; there is no 16-lane width, which
+    // GCC unrolls into something slower than two 8-lane passes.
+    template <int stride>
+    struct Lanes;
+
+    template <typename Activations>
+    void runWidth (int scratchIndex, const int* batchSlots, int numBatchSlots, int hopSize) noexcept
+    {
+        if (scratchIndex < 0)
+        {
+            runKernel<2, Activations> (fallbackLanes[batchSlots[0]], batchSlots, 1, hopSize);
+            return;
+        }
+
+        auto& buffers = scratch[scratchIndex];
+
+        if (numBatchSlots > 16)
+        {
+            runKernel<64, Activations> (buffers.batchLanes, batchSlots, numBatchSlots, hopSize);
+        }
+        else if (numBatchSlots > 12)
+        {
+            runKernel<32, Activations> (buffers.batchLanes, batchSlots, numBatchSlots, hopSize);
+        }
+        else
+        {
+            for (int first = 0; first < numBatchSlots; first += 4)
+            {
+                const auto numInGroup = std::min (4, numBatchSlots - first);
+
+                if (numInGroup == 1)      runKernel<2, Activations> (buffers.soloLanes, batchSlots + first, 1, hopSize);
+                else if (numInGroup == 2) runKernel<4, Activations> (buffers.quadLanes, batchSlots + first, 2, hopSize);
+                else                      runKernel<8, Activations> (buffers.octLanes, batchSlots + first, numInGroup, hopSize);
+            }
+        }
+    }
+
+    template <int numLanes, typename Activations, int stride>
+    void runKernel (Lanes<stride>& lanes, const int* batchSlots, int numBatchSlots, int hopSize) noexcept
+    {
+        static_assert (numLanes <= stride);
+
+        const auto& w = *weights;
+        auto& hidden = lanes.hidden;
+        auto& cell = lanes.cell;
+        auto& gates = lanes.gates;
+        const auto numUsedLanes = 2 * numBatchSlots;
+        const float* input[numLanes];
+        float* output[numLanes];
+        float effect[numLanes], effectStep[numLanes];
+
+        // gather; the lanes past the last slot run on zeros and are dropped
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            if (lane >= numUsedLanes)
+            {
+                for (int i = 0; i < hiddenSize; ++i)
+                    hidden[i][lane] = cell[i][lane] = 0.0f;
+
+                effect[lane] = effectStep[lane] = 0.0f;
+                continue;
+            }
+
+            const auto slot = batchSlots[lane / 2], channel = lane % 2;
+            auto& job = getSlot (slot);
+
+            if (job.resetState)
+            {
+                for (int i = 0; i < hiddenSize; ++i)
+                    slotHidden[slot][channel][i] = slotCell[slot][channel][i] = 0.0f;
+
+                slotEffect[slot] = job.effect;
+            }
+
+            for (int i = 0; i < hiddenSize; ++i)
+            {
+                hidden[i][lane] = slotHidden[slot][channel][i];
+                cell[i][lane] = slotCell[slot][channel][i];
+            }
+
+            input[lane] = job.input[channel];
+            output[lane] = job.output[channel];
+            effect[lane] = slotEffect[slot];
+            effectStep[lane] = (job.effect - slotEffect[slot]) / (float) hopSize;
+        }
+
+        for (int n = 0; n < hopSize; ++n)
+        {
+            float x[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                effect[lane] += effectStep[lane];
+                x[lane] = lane < numUsedLanes ? input[lane][n] : 0.0f;
+            }
+
+            for (int k = 0; k < numGates; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    gates[k][lane] = w.bias[k] + w.conditionWeights[k] * effect[lane] + w.inputWeights[k] * x[lane];
+
+            for (int j = 0; j < hiddenSize; ++j)
+            {
+                for (int k = 0; k < numGates; ++k)
+                {
+                    const auto weight = getRecurrentWeight (w, j, k);
+
+                    for (int lane = 0; lane < numLanes; ++lane)
+                        gates[k][lane] += weight * hidden[j][lane];
+                }
+            }
+
+            for (int k = 0; k < 2 * hiddenSize; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    gates[k][lane] = Activations::sigmoid (gates[k][lane]);
+
+            for (int k = 2 * hiddenSize; k < 3 * hiddenSize; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    gates[k][lane] = Activations::tanh (gates[k][lane]);
+
+            for (int k = 3 * hiddenSize; k < numGates; ++k)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    gates[k][lane] = Activations::sigmoid (gates[k][lane]);
+
+            for (int i = 0; i < hiddenSize; ++i)
+            {
+                for (int lane = 0; lane < numLanes; ++lane)
+                {
+                    cell[i][lane] = gates[hiddenSize + i][lane] * cell[i][lane] + gates[i][lane] * gates[2 * hiddenSize + i][lane];
+                    hidden[i][lane] = gates[3 * hiddenSize + i][lane] * Activations::tanh (cell[i][lane]);
+                }
+            }
+
+            float y[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                y[lane] = w.denseBias;
+
+            for (int i = 0; i < hiddenSize; ++i)
+                for (int lane = 0; lane < numLanes; ++lane)
+                    y[lane] += w.denseWeights[i] * hidden[i][lane];
+
+            for (int lane = 0; lane < numUsedLanes; ++lane)
+                output[lane][n] = y[lane];
+        }
+
+        // scatter the state back; the effect has reached the hop's value
+        for (int lane = 0; lane < numUsedLanes; ++lane)
+        {
+            const auto slot = batchSlots[lane / 2], channel = lane % 2;
+
+            for (int i = 0; i < hiddenSize; ++i)
+            {
+                slotHidden[slot][channel][i] = hidden[i][lane];
+                slotCell[slot][channel][i] = cell[i][lane];
+            }
+
+            slotEffect[slot] = getSlot (slot).effect;
+        }
+    }
+
+    std::shared_ptr<const Weights> weights;
+
+    // per slot state between hops
+    float slotHidden[maxSlots][2][hiddenSize] {};
+    float slotCell[maxSlots][2][hiddenSize] {};
+    float slotEffect[maxSlots] {};
+
+    // a batch being run. Up to 8 lanes get rows of their own width: a lone
+    // engine's 2-lane loops then vectorize along the rows, and 4 and 8 lanes at
+    // a 64-lane stride measured ten times slower. The wide batches measure
+    // faster at a shared 64-lane stride.
+    template <int stride>
+    struct Lanes
+    {
+        alignas (32) float hidden[hiddenSize][stride];
+        alignas (32) float cell[hiddenSize][stride];
+        alignas (32) float gates[numGates][stride];
+    };
+
+    struct Scratch
+    {
+        Lanes<2> soloLanes;
+        Lanes<4> quadLanes;
+        Lanes<8> octLanes;
+        Lanes<maxLanes> batchLanes;
+    };
+
+    // one per batch that can run at the same time, see DistBatchHub::ScopedScratch
+    std::unique_ptr<Scratch[]> scratch;
+
+    // per slot, for a job that finds every scratch set taken
+    std::unique_ptr<Lanes<2>[]> fallbackLanes;
+};
+
+// The hub of `weights`, created on first use: every engine built on the same
+// weights, in any instance, gets the same one. Locks and allocates, so use it
+// from the message thread or a loader thread.
+template <typename WeightsType>
+std::shared_ptr<DistBatchHub> getDistBatchHub (const std::shared_ptr<const WeightsType>& weights)
+{
+    static std::mutex mutex;
+    static std::map<const WeightsType*, std::weak_ptr<DistBatchHub>> hubs;
+
+    std::lock_guard<std::mutex> lock (mutex);
+
+    // a hub keeps its weights alive, so the address cannot be reused while it exists
+    auto& entry = hubs[weights.get()];
+    auto hub = entry.lock();
+
+    if (hub == nullptr)
+    {
+        hub = std::make_shared<DistBatchHubT<WeightsType::numGates / 4, WeightsType>> (weights);
+        entry = hub;
+    }
+
+    for (auto it = hubs.begin(); it != hubs.end();)
+        it = it->second.expired() ? hubs.erase (it) : std::next (it);
+
+    return hub;
+}
+
+// Two-lane engine with the DistLSTM interface that runs through a DistBatchHub.
+// Input is collected into hops of hopSize samples; at every hop boundary the
+// engine collects the result of its previous hop, batched with whatever else
+// is pending, and submits the next one. Output is getLatencySamples() late.
+//
+// There is no silence skipping, and knob changes ramp over one hop rather than
+// the smoothing length. Copies take a slot of their own and start from a reset
+// state; taking and releasing slots allocates, so not on the audio thread.
+class DistSharedLSTM
+{
+public:
+    static constexpr int numLanes = 2;
+
+    DistSharedLSTM (std::shared_ptr<DistBatchHub> batchHub, int hopSizeToUse)
+        : hub (std::move (batchHub)), hopSize (std::max (1, hopSizeToUse)),
+          pendingInput ((size_t) (numLanes * hopSize)), jobInput (pendingInput.size()),
+          jobOutput (pendingInput.size()), readyOutput (pendingInput.size())
+    {
+        slot = hub->acquireSlot (hopSize);
+        reset();
+    }
+
+    DistSharedLSTM (const DistSharedLSTM& other)
+        : DistSharedLSTM (other.hub, other.hopSize)
+    {
+        activationQuality = other.activationQuality;
+    }
+
+    DistSharedLSTM& operator= (const DistSharedLSTM& other)
+    {
+        auto copy = other;
+        return *this = std::move (copy);
+    }
+
+    DistSharedLSTM (DistSharedLSTM&& other) noexcept
+    {
+        takeOver (other);
+    }
+
+    DistSharedLSTM& operator= (DistSharedLSTM&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            takeOver (other);
+        }
+
+        return *this;
+    }
+
+    ~DistSharedLSTM()
+    {
+        release();
+    }
+
+    // False when the hub had no free slot; process() then leaves the audio dry.
+    bool isValid() const noexcept { return slot >= 0; }
+
+    int getHopSize() const noexcept { return hopSize; }
+    int getLatencySamples() const noexcept { return 2 * hopSize; }
+
+    void reset() noexcept
+    {
+        if (jobPending)
+            hub->finish (slot, false);
+
+        jobPending = false;
+        resetPending = true;
+        position = 0;
+
+        std::fill (pendingInput.begin(), pendingInput.end(), 0.0f);
+        std::fill (readyOutput.begin(), readyOutput.end(), 0.0f);
+    }
+
+    void setSmoothingLength (int) noexcept {}
+    void setSilenceSkipping (bool) noexcept {}
+    bool isIdle() const noexcept { return false; }
+
+    // A batch runs at the most accurate tier any of its engines asks for.
+    void setActivationQuality (ActivationQuality newQuality) noexcept { activationQuality = newQuality; }
+    ActivationQuality getActivationQuality() const noexcept { return activationQuality; }
+
+    // Processes up to numLanes channels in place. Lanes without a channel are fed silence.
+    void process (float* const* channels, int numChannels, int numSamples, float effect) noexcept
+    {
+        targetEffect = effect;
+
+        if (slot < 0)
+            return;
+
+        numChannels = numChannels < numLanes ? numChannels : numLanes;
+
+        for (int done = 0; done < numSamples;)
+        {
+            const auto numToCopy = std::min (numSamples - done, hopSize - position);
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                auto* input = pendingInput.data() + lane * hopSize + position;
+
+                if (lane < numChannels)
+                {
+                    const auto* output = readyOutput.data() + lane * hopSize + position;
+                    std::copy (channels[lane] + done, channels[lane] + done + numToCopy, input);
+                    std::copy (output, output + numToCopy, channels[lane] + done);
+                }
+                else
+                {
+                    std::fill (input, input + numToCopy, 0.0f);
+                }
+            }
+
+            done += numToCopy;
+            position += numToCopy;
+
+            if (position == hopSize)
+            {
+                position = 0;
+                advanceHop();
+            }
+        }
+    }
+
+    const std::shared_ptr<DistBatchHub>& getHub() const noexcept { return hub; }
+    std::shared_ptr<const void> getSharedWeights() const noexcept { return hub->getSharedWeights(); }
+
+private:
+    void advanceHop() noexcept
+    {
+        auto& job = hub->getSlot (slot);
+
+        if (jobPending)
+        {
+            hub->finish (slot, ! DistBatchHub::isSoloProcessing());
+            std::swap (readyOutput, jobOutput);
+        }
+
+        std::swap (pendingInput, jobInput);
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            job.input[lane] = jobInput.data() + lane * hopSize;
+            job.output[lane] = jobOutput.data() + lane * hopSize;
+        }
+
+        job.effect = targetEffect;
+        job.activationQuality = activationQuality;
+        job.resetState = resetPending;
+        resetPending = false;
+
+        hub->submit (slot);
+        jobPending = true;
+    }
+
+    void takeOver (DistSharedLSTM& other) noexcept
+    {
+        // a pending job points into the buffers, which move along with their storage
+        hub = std::move (other.hub);
+        slot = other.slot;
+        hopSize = other.hopSize;
+        jobPending = other.jobPending;
+        resetPending = other.resetPending;
+        position = other.position;
+        targetEffect = other.targetEffect;
+        activationQuality = other.activationQuality;
+        pendingInput = std::move (other.pendingInput);
+        jobInput = std::move (other.jobInput);
+        jobOutput = std::move (other.jobOutput);
+        readyOutput = std::move (other.readyOutput);
+
+        other.slot = -1;
+        other.jobPending = false;
+    }
+
+    void release() noexcept
+    {
+        if (slot < 0)
+            return;
+
+        if (jobPending)
+            hub->finish (slot, false);
+
+        hub->releaseSlot (slot);
+        slot = -1;
+        jobPending = false;
+    }
+
+    std::shared_ptr<DistBatchHub> hub;
+    int slot = -1, hopSize = 1;
+    bool jobPending = false, resetPending = true;
+    int position = 0;
+    float targetEffect = 0.0f;
+    ActivationQuality activationQuality = defaultActivationQuality;
+
+    // [lane * hopSize + n]: the hop being collected, the one the hub works on,
+    // and the result being played
+    std::vector<float> pendingInput, jobInput, jobOutput, readyOutput;
+};
+
+#endif /* DistSharedLSTM_h */
@@ -0,0 +1,118 @@
+#ifndef DistWeightCache_h
+#define DistWeightCache_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide store of immutable model weights, keyed by a hash of the model
+// file contents. Every plugin instance loading the same model gets the same
+// read-only weights and only owns its small per-channel LSTM state, so dozens
+// of instances cost one copy of the weights in memory and in the CPU caches.
+//
+// Each entry keeps a copy of the file it was loaded from (a few KB to a few
+// hundred), and a hit only counts when the bytes match: two models whose hashes
+// collide still get their own weights.
+//
+// Entries are weak: weights are freed when the last engine using them goes
+// away. Lookups lock a mutex, so use this from the message thread or a loader
+// thread, never from the audio thread; the load itself runs outside the lock.
+class DistWeightCache
+{
+public:
+    struct Entry
+    {
+        std::shared_ptr<const void> weights;
+        size_t engineIndex = 0; // which engine type the weights belong to
+    };
+
+    static DistWeightCache& getInstance()
+    {
+        static DistWeightCache cache;
+        return cache;
+    }
+
+    // Returns the live entry loaded from the `size` bytes at `data`, whose hash is
+    // `key`, or calls load() to create it. load must return an Entry, with null
+    // weights if loading failed. Two threads loading the same data at once both
+    // run load(), and the second one gets the first one's weights.
+    template <typename LoadFn>
+    Entry getOrLoad (uint64_t key, const char* data, size_t size, LoadFn&& load)
+    {
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            Entry live;
+
+            if (findLive (key, data, size, live))
+                return live;
+        }
+
+        auto entry = load();
+
+        if (entry.weights == nullptr)
+            return entry;
+
+        std::lock_guard<std::mutex> lock (mutex);
+        Entry live;
+
+        if (findLive (key, data, size, live))
+            return live;
+
+        removeExpiredEntries();
+
+        // a live entry for other data with the same hash keeps its place, this one goes uncached
+        if (entries.find (key) == entries.end())
+            entries[key] = { entry.weights, entry.engineIndex, std::string (data, size) };
+
+        return entry;
+    }
+
+    size_t getNumLiveEntries()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        removeExpiredEntries();
+        return entries.size();
+    }
+
+private:
+    DistWeightCache() = default;
+
+    struct WeakEntry
+    {
+        std::weak_ptr<const void> weights;
+        size_t engineIndex = 0;
+        std::string source;
+    };
+
+    bool findLive (uint64_t key, const char* data, size_t size, Entry& live) const
+    {
+        const auto found = entries.find (key);
+
+        if (found == entries.end())
+            return false;
+
+        const auto& source = found->second.source;
+
+        if (source.size() != size || (size > 0 && std::memcmp (source.data(), data, size) != 0))
+            return false;
+
+        live.weights = found->second.weights.lock();
+        live.engineIndex = found->second.engineIndex;
+        return live.weights != nullptr;
+    }
+
+    void removeExpiredEntries()
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+            it = it->second.weights.expired() ? entries.erase (it) : std::next (it);
+    }
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, WeakEntry> entries;
+};
+
+#endif /* DistWeightCache_h */
@@ -0,0 +1,58 @@
+#ifndef LevelMeter_h
+#define LevelMeter_h
+
+#include <JuceHeader.h>
+
+// Thin vertical bar showing a level in dB, -60..0 dB bottom to top. Falls back
+// slowly after peaks and only repaints when the drawn height changes, so a
+// quiet meter costs nothing per frame.
+class LevelMeter : public juce::Component
+{
+public:
+    explicit LevelMeter (juce::Colour barColour, bool fromTop = false)
+        : colour (barColour), hangsFromTop (fromTop)
+    {
+        setInterceptsMouseClicks (false, false);
+    }
+
+    // Called once per editor frame with the loudest level since the previous one.
+    void setLevel (float newDecibels)
+    {
+        // about 20 dB per second of fall-back at 30 frames per second
+        decibels = juce::jmax (newDecibels, decibels - 0.7f);
+
+        const auto height = getBarHeight();
+
+        if (height != drawnHeight)
+        {
+            drawnHeight = height;
+            repaint();
+        }
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto area = getLocalBounds();
+        g.setColour (juce::Colours::black.withAlpha (0.4f));
+        g.fillRect (area);
+
+        g.setColour (colour);
+        g.fillRect (hangsFromTop ? area.removeFromTop (drawnHeight) : area.removeFromBottom (drawnHeight));
+    }
+
+private:
+    int getBarHeight() const
+    {
+        const auto proportion = juce::jlimit (0.0f, 1.0f, (decibels + 60.0f) / 60.0f);
+        return juce::roundToInt (proportion * (float) getHeight());
+    }
+
+    juce::Colour colour;
+    bool hangsFromTop;
+    float decibels { -100.0f };
+    int drawnHeight { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
+
+#endif /* LevelMeter_h */
@@ -0,0 +1,211 @@
+#ifndef LoadMonitor_h
+#define LoadMonitor_h
+
+#include "SpscRing.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+// Measures how much of its deadline every processBlock call uses.
+//
+// The audio thread brackets each block with startBlock()/endBlock(): two clock
+// reads, a few relaxed counter updates and one push into a wait-free ring, so it
+// stays on in release builds. The message thread calls collect() periodically to
+// drain the ring into the min/average/max/p99 load (load = processing time /
+// buffer duration, so 1.0 is a missed deadline) and can look at every block on
+// the way, e.g. to log it.
+class LoadMonitor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct BlockTiming
+    {
+        double seconds = 0.0;   // time spent in the block
+        float load = 0.0f;      // seconds / buffer duration
+        int numSamples = 0;
+        bool overrun = false;
+        bool denormalHeavy = false;
+    };
+
+    struct Stats
+    {
+        int64_t numBlocks = 0, numOverruns = 0, numDenormalBlocks = 0, numDropped = 0;
+        double minLoad = 0.0, averageLoad = 0.0, maxLoad = 0.0, p99Load = 0.0;
+
+        // only the blocks drained by the latest collect()
+        int64_t numRecentBlocks = 0;
+        double recentAverageLoad = 0.0, recentMaxLoad = 0.0;
+    };
+
+    // Audio side ---------------------------------------------------------------
+
+    void prepare (double sampleRate) noexcept
+    {
+        secondsPerSample = sampleRate > 0.0 ? 1.0 / sampleRate : 0.0;
+
+        // not running concurrently with endBlock, so the audio side can restart its counters
+        for (auto* counter : { &numBlocks, &numOverruns, &numDenormalBlocks, &numDropped })
+            counter->store (0, std::memory_order_relaxed);
+
+        resetRequested.store (true, std::memory_order_release);
+    }
+
+    Clock::time_point startBlock() const noexcept { return Clock::now(); }
+
+    void endBlock (Clock::time_point start, int numSamples, bool denormalHeavy) noexcept
+    {
+        if (numSamples <= 0 || secondsPerSample == 0.0)
+            return;
+
+        BlockTiming timing;
+        timing.seconds = std::chrono::duration<double> (Clock::now() - start).count();
+        timing.load = (float) (timing.seconds / (numSamples * secondsPerSample));
+        timing.numSamples = numSamples;
+        timing.overrun = timing.load > 1.0f;
+        timing.denormalHeavy = denormalHeavy;
+
+        // the counters only have this one writer, so plain load + store is enough
+        increment (numBlocks);
+
+        if (timing.overrun)
+            increment (numOverruns);
+
+        if (denormalHeavy)
+            increment (numDenormalBlocks);
+
+        if (! ring.push (timing))
+            increment (numDropped);
+    }
+
+    // True when more than an eighth of the samples are subnormal, which is what
+    // makes decaying tails slow on CPUs that are not flushing them to zero.
+    // Tests the bit patterns, so it works whatever the FTZ/DAZ mode is.
+    static bool isDenormalHeavy (const float* const* channels, int numChannels, int numSamples) noexcept
+    {
+        int numDenormals = 0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                uint32_t bits;
+                std::memcpy (&bits, channels[ch] + n, sizeof (bits));
+                numDenormals += (bits & 0x7f800000u) == 0 && (bits & 0x007fffffu) != 0;
+            }
+        }
+
+        return numDenormals * 8 > numChannels * numSamples;
+    }
+
+    // Message thread side -------------------------------------------------------
+
+    template <typename BlockFn>
+    void collect (BlockFn&& onBlock)
+    {
+        if (resetRequested.exchange (false, std::memory_order_acq_rel))
+        {
+            baseline = {};
+            clearStats();
+        }
+
+        BlockTiming timing;
+        double recentSum = 0.0;
+        stats.numRecentBlocks = 0;
+        stats.recentMaxLoad = 0.0;
+
+        while (ring.pop (timing))
+        {
+            onBlock (timing);
+
+            recentSum += timing.load;
+            ++stats.numRecentBlocks;
+            stats.recentMaxLoad = timing.load > stats.recentMaxLoad ? timing.load : stats.recentMaxLoad;
+
+            const double load = timing.load;
+            stats.minLoad = numTimed == 0 ? load : (load < stats.minLoad ? load : stats.minLoad);
+            stats.maxLoad = numTimed == 0 ? load : (load > stats.maxLoad ? load : stats.maxLoad);
+            loadSum += load;
+            ++numTimed;
+            ++histogram[(size_t) (load < maxHistogramLoad ? load * binsPerUnit : numHistogramBins - 1)];
+        }
+
+        stats.numBlocks = numBlocks.load (std::memory_order_relaxed) - baseline.numBlocks;
+        stats.numOverruns = numOverruns.load (std::memory_order_relaxed) - baseline.numOverruns;
+        stats.numDenormalBlocks = numDenormalBlocks.load (std::memory_order_relaxed) - baseline.numDenormalBlocks;
+        stats.numDropped = numDropped.load (std::memory_order_relaxed) - baseline.numDropped;
+        stats.averageLoad = numTimed > 0 ? loadSum / (double) numTimed : 0.0;
+        stats.recentAverageLoad = stats.numRecentBlocks > 0 ? recentSum / (double) stats.numRecentBlocks : 0.0;
+        stats.p99Load = getPercentile (0.99);
+    }
+
+    void collect() { collect ([] (const BlockTiming&) {}); }
+
+    // Starts the statistics afresh (prepare() does this too).
+    void resetStats()
+    {
+        baseline.numBlocks = numBlocks.load (std::memory_order_relaxed);
+        baseline.numOverruns = numOverruns.load (std::memory_order_relaxed);
+        baseline.numDenormalBlocks = numDenormalBlocks.load (std::memory_order_relaxed);
+        baseline.numDropped = numDropped.load (std::memory_order_relaxed);
+        clearStats();
+    }
+
+    const Stats& getStats() const noexcept { return stats; }
+
+private:
+    static constexpr int binsPerUnit = 200;                   // 0.5% resolution
+    static constexpr double maxHistogramLoad = 2.0;           // anything above lands in the last bin
+    static constexpr int numHistogramBins = (int) (maxHistogramLoad * binsPerUnit) + 1;
+
+    static void increment (std::atomic<int64_t>& counter) noexcept
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clearStats()
+    {
+        stats = {};
+        histogram.fill (0);
+        loadSum = 0.0;
+        numTimed = 0;
+    }
+
+    // Upper edge of the bin holding the given fraction of the timed blocks.
+    double getPercentile (double fraction) const
+    {
+        const auto target = (int64_t) (fraction * (double) numTimed);
+        int64_t count = 0;
+
+        for (int bin = 0; bin < numHistogramBins; ++bin)
+        {
+            count += histogram[(size_t) bin];
+
+            if (count > target)
+            {
+                const auto upperEdge = (bin + 1) / (double) binsPerUnit;
+                return bin == numHistogramBins - 1 || upperEdge > stats.maxLoad ? stats.maxLoad : upperEdge;
+            }
+        }
+
+        return stats.maxLoad;
+    }
+
+    // audio thread
+    double secondsPerSample = 0.0;
+    SpscRing<BlockTiming, 4096> ring;
+    std::atomic<int64_t> numBlocks { 0 }, numOverruns { 0 }, numDenormalBlocks { 0 }, numDropped { 0 };
+    std::atomic<bool> resetRequested { false };
+
+    // message thread
+    Stats stats, baseline;
+    std::array<int64_t, numHistogramBins> histogram {};
+    double loadSum = 0.0;
+    int64_t numTimed = 0;
+};
+
+#endif /* LoadMonitor_h */
@@ -0,0 +1,272 @@
+#ifndef NativeRateProcessor_h
+#define NativeRateProcessor_h
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+// Streaming rational-ratio resampler (L/M polyphase FIR). Each output sample costs
+// tapsPerPhase multiply-adds: baseTapsPerPhase when upsampling, and that many
+// times M/L when downsampling, so that the filter spans the same time at the
+// lower rate whatever the ratio.
+//
+// The low-pass is centred on the lower Nyquist frequency and its transition
+// band is 4.1 kHz wide at 44.1 kHz (20 to 24.1 kHz): everything up to 20 kHz
+// passes, and what would alias or image below 20 kHz is rejected by about
+// 90 dB. TRAIN/resampler.cpp (distnn-resampler) measures this.
+class PolyphaseResampler
+{
+public:
+    static constexpr int baseTapsPerPhase = 64;
+
+    // Allocates, call from prepareToPlay.
+    void prepare (int upFactor, int downFactor)
+    {
+        L = upFactor;
+        M = downFactor;
+        tapsPerPhase = (baseTapsPerPhase * std::max (L, M) / L + 3) / 4 * 4;
+
+        // windowed-sinc low-pass at the lower of the two Nyquist frequencies,
+        // designed at the upsampled rate, then split into L phases
+        const int length = L * tapsPerPhase;
+        const double cutoff = 0.5 / (double) std::max (L, M);
+        const double centre = 0.5 * (length - 1);
+        const double beta = 9.0;
+        const double pi = 3.14159265358979323846;
+
+        coefficients.assign ((size_t) length, 0.0f);
+        std::vector<double> phaseSums ((size_t) L, 0.0);
+
+        for (int i = 0; i < length; ++i)
+        {
+            const double t = (double) i - centre;
+            const double sinc = t == 0.0 ? 2.0 * cutoff : std::sin (2.0 * pi * cutoff * t) / (pi * t);
+            const double r = t / (centre + 1.0);
+            const double window = besselI0 (beta * std::sqrt (std::max (0.0, 1.0 - r * r))) / besselI0 (beta);
+
+            // phase-major order, so one output reads tapsPerPhase contiguous values
+            const int phase = i % L, tap = i / L;
+            coefficients[(size_t) (phase * tapsPerPhase + tap)] = (float) (sinc * window);
+            phaseSums[(size_t) phase] += sinc * window;
+        }
+
+        // every phase passes DC at exactly unity gain, so a constant input
+        // does not come out modulated at the phase rate
+        for (int i = 0; i < length; ++i)
+            coefficients[(size_t) i] = (float) (coefficients[(size_t) i] / phaseSums[(size_t) (i / tapsPerPhase)]);
+
+        history.assign ((size_t) (2 * tapsPerPhase), 0.0f);
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill (history.begin(), history.end(), 0.0f);
+        writePos = 0;
+        phase = 0;
+    }
+
+    // Filter delay, in output samples.
+    double getLatency() const
+    {
+        return 0.5 * (L * tapsPerPhase - 1) / (double) M;
+    }
+
+    // Largest number of outputs `numInputs` samples can produce.
+    int getMaxOutputs (int numInputs) const
+    {
+        return (int) (((long long) numInputs * L) / M) + 1;
+    }
+
+    // Consumes every input and returns the number of outputs written.
+    int process (const float* input, int numInputs, float* output) noexcept
+    {
+        int numOutputs = 0;
+
+        for (int n = 0; n < numInputs; ++n)
+        {
+            // history is stored twice so the newest tapsPerPhase samples are always contiguous
+            writePos = (writePos == 0 ? tapsPerPhase : writePos) - 1;
+            history[(size_t) writePos] = history[(size_t) (writePos + tapsPerPhase)] = input[n];
+            const float* newest = history.data() + writePos;
+
+            for (; phase < L; phase += M)
+            {
+                const float* h = coefficients.data() + phase * tapsPerPhase;
+                float y = 0.0f;
+
+                for (int k = 0; k < tapsPerPhase; ++k)
+                    y += h[k] * newest[k];
+
+                output[numOutputs++] = y;
+            }
+
+            phase -= L;
+        }
+
+        return numOutputs;
+    }
+
+private:
+    static double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    std::vector<float> coefficients, history;
+    int L = 1, M = 1, tapsPerPhase = baseTapsPerPhase, writePos = 0, phase = 0;
+};
+
+// Runs a model at its training sample rate inside a session at another rate:
+// every block is resampled to the model rate, processed there, and resampled
+// back. The round trip has a fixed latency (getLatencySamples) that the plugin
+// reports to the host. At 88.2/96 kHz the model runs about half as often.
+class NativeRateProcessor
+{
+public:
+    // Allocates, call from prepareToPlay. Only integer rates are supported;
+    // isActive() is false when the rates match or the ratio is unusable.
+    void prepare (double hostSampleRate, double modelSampleRate, int blockSize, int maxChannels)
+    {
+        const auto hostRate = (int) std::lround (hostSampleRate);
+        const auto modelRate = (int) std::lround (modelSampleRate);
+        const auto divisor = std::gcd (hostRate, modelRate);
+
+        active = hostRate > 0 && modelRate > 0 && hostRate != modelRate
+              && hostRate / divisor <= 1024 && modelRate / divisor <= 1024;
+
+        if (! active)
+            return;
+
+        const int hostFactor = hostRate / divisor, modelFactor = modelRate / divisor;
+        maxBlockSize = std::max (1, blockSize);
+        channels.resize ((size_t) maxChannels);
+        chunkPointers.resize ((size_t) maxChannels);
+
+        for (auto& channel : channels)
+        {
+            channel.down.prepare (modelFactor, hostFactor);
+            channel.up.prepare (hostFactor, modelFactor);
+        }
+
+        const auto& probe = channels.front();
+        maxModelBlock = probe.down.getMaxOutputs (maxBlockSize);
+
+        // the number of samples coming back per block jitters by a couple of samples
+        // around numSamples, so the output FIFO starts with that much in it
+        prefill = 2 + (hostFactor + modelFactor - 1) / modelFactor;
+        latency = (int) std::lround (probe.down.getLatency() * hostFactor / modelFactor + probe.up.getLatency()) + prefill;
+
+        fifoSize = maxBlockSize + probe.up.getMaxOutputs (maxModelBlock) + prefill + 1;
+        modelPointers.resize ((size_t) maxChannels);
+
+        for (size_t ch = 0; ch < channels.size(); ++ch)
+        {
+            channels[ch].modelBuffer.assign ((size_t) maxModelBlock, 0.0f);
+            channels[ch].upBuffer.assign ((size_t) channels[ch].up.getMaxOutputs (maxModelBlock), 0.0f);
+            channels[ch].fifo.assign ((size_t) fifoSize, 0.0f);
+            modelPointers[ch] = channels[ch].modelBuffer.data();
+        }
+
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& channel : channels)
+        {
+            channel.down.reset();
+            channel.up.reset();
+            std::fill (channel.fifo.begin(), channel.fifo.end(), 0.0f);
+        }
+
+        readPos = 0;
+        numQueued = prefill;
+    }
+
+    bool isActive() const noexcept { return active; }
+
+    // Most samples processAtModelRate can be given at once.
+    int getMaxModelBlockSize() const noexcept { return active ? maxModelBlock : 0; }
+    int getLatencySamples() const noexcept { return active ? latency : 0; }
+
+    // Resamples `numSamples` host-rate samples per channel down to the model rate,
+    // calls processAtModelRate (float* const* channels, int numChannels, int numSamples)
+    // on them, and writes the resampled result back in place.
+    template <typename ProcessFn>
+    void process (float* const* data, int numChannels, int numSamples, ProcessFn&& processAtModelRate) noexcept
+    {
+        numChannels = std::min (numChannels, (int) channels.size());
+
+        // hosts occasionally send more than they announced in prepareToPlay
+        for (int start = 0; start < numSamples; start += maxBlockSize)
+        {
+            const auto numInChunk = std::min (maxBlockSize, numSamples - start);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                chunkPointers[(size_t) ch] = data[ch] + start;
+
+            processChunk (chunkPointers.data(), numChannels, numInChunk, processAtModelRate);
+        }
+    }
+
+private:
+    template <typename ProcessFn>
+    void processChunk (float* const* data, int numChannels, int numSamples, ProcessFn& processAtModelRate) noexcept
+    {
+        // every channel shares the same resampler phase, so they all produce the same count
+        int numModelSamples = 0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            numModelSamples = channels[(size_t) ch].down.process (data[ch], numSamples, channels[(size_t) ch].modelBuffer.data());
+
+        processAtModelRate (modelPointers.data(), numChannels, numModelSamples);
+
+        int numBack = 0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto& channel = channels[(size_t) ch];
+            numBack = channel.up.process (channel.modelBuffer.data(), numModelSamples, channel.upBuffer.data());
+
+            for (int n = 0; n < numBack; ++n)
+                channel.fifo[(size_t) ((readPos + numQueued + n) % fifoSize)] = channel.upBuffer[(size_t) n];
+        }
+
+        numQueued += numBack;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto& fifo = channels[(size_t) ch].fifo;
+
+            for (int n = 0; n < numSamples; ++n)
+                data[ch][n] = n < numQueued ? fifo[(size_t) ((readPos + n) % fifoSize)] : 0.0f;
+        }
+
+        const auto numRead = std::min (numSamples, numQueued);
+        readPos = (readPos + numRead) % fifoSize;
+        numQueued -= numRead;
+    }
+
+    struct Channel
+    {
+        PolyphaseResampler down, up;
+        std::vector<float> modelBuffer, upBuffer, fifo;
+    };
+
+    std::vector<Channel> channels;
+    std::vector<float*> modelPointers, chunkPointers;
+    int maxBlockSize = 1, maxModelBlock = 0, fifoSize = 1, readPos = 0, numQueued = 0, prefill = 0, latency = 0;
+    bool active = false;
+};
+
+#endif /* NativeRateProcessor_h */
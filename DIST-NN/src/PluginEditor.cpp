@@ -13,6 +13,9 @@
 DISTNNAudioProcessorEditor::DISTNNAudioProcessorEditor (DISTNNAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
+    backgroundSource = juce::ImageCache::getFromMemory (BinaryData::DIST_png, BinaryData::DIST_pngSize);
+    setOpaque (true);
+
     setLookAndFeel (&otherLookAndFeel);
     
     // Make sure that before the constructor has finished, you've set the
@@ -32,11 +35,23 @@ DISTNNAudioProcessorEditor::DISTNNAudioProcessorEditor (DISTNNAudioProcessor& p)
     On.onClick = [this](){play();};
     On.addListener(this);
     addAndMakeVisible (On);
-    imagesDir = juce::File(juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getFullPathName() + "/DistNNutils/Images");
+
+    loadLabel.setFont (juce::Font (11.0f));
+    loadLabel.setJustificationType (juce::Justification::centred);
+    loadLabel.setColour (juce::Label::textColourId, juce::Colours::white.withAlpha (0.7f));
+    addAndMakeVisible (loadLabel);
+
+    addAndMakeVisible (inputMeter);
+    addAndMakeVisible (outputMeter);
+    addAndMakeVisible (gainReductionMeter);
+
+    // meters are the only thing animating, 30 frames per second is plenty
+    startTimerHz (30);
 }
 
 DISTNNAudioProcessorEditor::~DISTNNAudioProcessorEditor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -47,12 +62,8 @@ void DISTNNAudioProcessorEditor::paint (juce::Graphics& g)
     //juce::Rectangle<int> box (300, 120, 200, 170);
     // g.setColour (juce::Colours::orange);
     // g.fillRect (box);
-    background = juce::ImageCache::getFromFile(imagesDir.getFullPathName() + "/DIST.png");
-    //background = juce::ImageCache::getFromMemory(BinaryData::DIST_png, BinaryData::DIST_pngSize);
-    g.drawImageWithin(background, 0, 0, 300, 450, juce::RectanglePlacement::stretchToFit);
-
-    
-    
+    // already at the editor size, so this is a plain copy
+    g.drawImageAt (background, 0, 0);
 }
 
 void DISTNNAudioProcessorEditor::resized()
@@ -62,6 +73,17 @@ void DISTNNAudioProcessorEditor::resized()
     
     phaserKnob.setBounds(border-27, border+40, getWidth() - border, getHeight()/2 - border);
     On.setBounds (buttonBorder, buttonBorder*2.5 +100, buttonBorder, buttonBorder/2);
+    loadLabel.setBounds (getLocalBounds().removeFromBottom (20));
+
+    auto meterArea = getLocalBounds().removeFromRight (28).withTrimmedTop (100).withTrimmedBottom (100).withTrimmedRight (6);
+    gainReductionMeter.setBounds (meterArea.removeFromRight (5));
+    meterArea.removeFromRight (2);
+    outputMeter.setBounds (meterArea.removeFromRight (5));
+    meterArea.removeFromRight (2);
+    inputMeter.setBounds (meterArea.removeFromRight (5));
+
+    if (backgroundSource.isValid())
+        background = backgroundSource.rescaled (getWidth(), getHeight(), juce::Graphics::highResamplingQuality);
     
 }
 
@@ -100,3 +122,49 @@ void DISTNNAudioProcessorEditor::stop(){
     On.setToggleState(false, NotificationType::dontSendNotification);
     On.setColour((TextButton::ColourIds::buttonColourId), Colours::rebeccapurple);
 }
+
+void DISTNNAudioProcessorEditor::timerCallback()
+{
+    DISTNNAudioProcessor::MeterLevels levels;
+
+    if (audioProcessor.readMeterLevels (levels))
+    {
+        const auto toDecibels = [] (float gain) { return juce::Decibels::gainToDecibels (gain, -100.0f); };
+
+        inputMeter.setLevel (toDecibels (levels.inputPeak));
+        outputMeter.setLevel (toDecibels (levels.outputPeak));
+
+        // how much quieter the output is than the input, drawn down from the top
+        gainReductionMeter.setLevel (juce::jmax (0.0f, toDecibels (levels.inputRms) - toDecibels (levels.outputRms)) - 60.0f);
+    }
+    else
+    {
+        // transport stopped: let the meters fall back
+        inputMeter.setLevel (-100.0f);
+        outputMeter.setLevel (-100.0f);
+        gainReductionMeter.setLevel (-100.0f);
+    }
+
+    if (--framesUntilLoadUpdate > 0)
+        return;
+
+    framesUntilLoadUpdate = 8;
+
+    // share of the buffer duration processBlock takes, since the last prepareToPlay
+    const auto& stats = audioProcessor.getLoadStats();
+
+    if (stats.numBlocks == 0)
+        return;
+
+    auto text = "CPU " + juce::String (stats.averageLoad * 100.0, 1) + "% avg, "
+              + juce::String (stats.p99Load * 100.0, 1) + "% p99, "
+              + juce::String (stats.maxLoad * 100.0, 1) + "% max";
+
+    if (stats.numOverruns > 0)
+        text << ", " << (int) stats.numOverruns << " overruns";
+
+    if (stats.numDenormalBlocks > 0)
+        text << ", " << (int) stats.numDenormalBlocks << " denormal blocks";
+
+    loadLabel.setText (text, juce::dontSendNotification);
+}
@@ -11,6 +11,7 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 #include "setLookAndFeel.h"
+#include "LevelMeter.h"
 //==============================================================================
 /**
 */
@@ -18,7 +19,8 @@
 
 class DISTNNAudioProcessorEditor  : public juce::AudioProcessorEditor,
                                        public juce::Slider::Listener,
-                                       public juce::Button::Listener
+                                       public juce::Button::Listener,
+                                       private juce::Timer
 {
 public:
     DISTNNAudioProcessorEditor (DISTNNAudioProcessor&);
@@ -35,8 +37,10 @@ public:
     void stop();
 
 private:
+    void timerCallback() override;
     
-    juce::Image background;
+    // decoded once from BinaryData, rescaled only when the editor size changes
+    juce::Image backgroundSource, background;
     DISTNNAudioProcessor& audioProcessor;
     
     enum class PlayState {
@@ -49,7 +53,10 @@ private:
     OtherLookAndFeel otherLookAndFeel;
     juce::Slider phaserKnob;
     juce::TextButton On;
-    juce::File imagesDir;
+    juce::Label loadLabel;
+    LevelMeter inputMeter { juce::Colours::limegreen }, outputMeter { juce::Colours::orange },
+               gainReductionMeter { juce::Colours::red, true };
+    int framesUntilLoadUpdate { 0 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DISTNNAudioProcessorEditor)
 };
@@ -22,13 +22,31 @@ DISTNNAudioProcessor::DISTNNAudioProcessor()
                        )
 #endif
 {
-    MemoryInputStream jsonStream (BinaryData::modelParametricDIST16_json, BinaryData::modelParametricDIST16_jsonSize, false);
-    loadModel(jsonStream,model);
+    addParameter (modelSize = new juce::AudioParameterChoice ({ "model", 1 }, "Model", { "8", "16", "24", "32" }, (int) loadedSource.size));
+    addParameter (nativeRate = new juce::AudioParameterBool ({ "nativeRate", 1 }, "Run at model rate", true));
+    addParameter (adaptiveQuality = new juce::AudioParameterBool ({ "adaptiveQuality", 1 }, "Adaptive quality", false));
+    addParameter (activations = new juce::AudioParameterChoice ({ "activations", 1 }, "Activations", { "Exact", "High", "Medium", "Fast" },
+                                                                (int) defaultActivationQuality));
+    addParameter (useModelsDir = new juce::AudioParameterBool ({ "useModelsDir", 1 }, "Use models folder", false));
+    addParameter (sharedEngine = new juce::AudioParameterBool ({ "sharedEngine", 1 }, "Batch with other instances (+2 blocks latency)", false));
 
+    // trained models dropped here are picked up while the plug in runs, see pollModelsDir()
+    modelsDir = juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory).getChildFile ("DIST-NN").getChildFile ("Models");
+
+    numEngines = (juce::jmax (getTotalNumInputChannels(), getTotalNumOutputChannels()) + 1) / 2;
+
+    // built in the background so that scanning and opening the plug in return right
+    // away; processBlock passes the audio through until the models are there
+    startLoading (loadedSource);
+    startTimerHz (10);
 }
 
 DISTNNAudioProcessor::~DISTNNAudioProcessor()
 {
+    stopTimer();
+
+    // a load nobody will hear stops at its next check rather than running to the end
+    cancelLoading (-1);
 }
 
 //==============================================================================
@@ -96,13 +114,84 @@ void DISTNNAudioProcessor::changeProgramName (int index, const juce::String& new
 //==============================================================================
 void DISTNNAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    model.reset();
+    models.collectGarbage();
+
+    const auto numChannels = juce::jmax (getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    // playback starts on the model the parameters ask for (set by the host or a
+    // restored session just before), rather than switching a timer tick later;
+    // a bounce in adaptive mode starts on the largest model right away
+    adaptiveController.reset();
+    auto sourceToPlay = loadedSource;
+
+    if (sourceToPlay.file == juce::File())
+        sourceToPlay.size = *adaptiveQuality && isNonRealtime() ? ModelSize::hidden32 : (ModelSize) modelSize->getIndex();
+
+    nativeRateProcessor.prepare (sampleRate, distModelSampleRate, samplesPerBlock, numChannels);
+    maxBlockSize = samplesPerBlock;
+    hostSampleRate = sampleRate;
+
+    // shared engines hop by whole blocks, so a new block size means new engines
+    sourceToPlay.hopSize = *sharedEngine ? getSharedHopSize() : 0;
+
+    // every channel pair gets its own LSTM state; the weights are shared
+    const auto needsNewModels = (numChannels + 1) / 2 != numEngines || sourceToPlay != loadedSource;
+
+    // the audio thread is stopped. A background load is cancelled when the bank is
+    // rebuilt below anyway, and otherwise given up to loadWaitMs to finish; one
+    // that takes longer hands its bank over to processBlock like any other
+    if (needsNewModels)
+        cancelLoading (loadWaitMs);
+    else
+        waitForLoading (loadWaitMs);
+
+    // the banks are put in under readyLock, so that a load that ran past the
+    // timeout cannot publish over them, see startLoading()
+    {
+        const juce::ScopedLock lock (readyLock);
+
+        if (readyModels != nullptr)
+            models.reset (std::move (readyModels));
+    }
+
+    if (needsNewModels)
+    {
+        numEngines = (numChannels + 1) / 2;
+
+        if (auto newModels = loadModels (sourceToPlay, numEngines))
+        {
+            const juce::ScopedLock lock (readyLock);
+            models.reset (std::move (newModels));
+            loadedSource = sourceToPlay;
+        }
+    }
+
+    // from three pairs up (5.1 and wider) the pairs are split over worker threads,
+    // as many as there are spare cores
+    const auto numCores = (int) std::thread::hardware_concurrency();
+    workers.prepare (numEngines >= 3 && numCores > 1 ? juce::jmin (numEngines, numCores) - 1 : 0);
+
+    crossfadeBuffer.setSize (numChannels, juce::jmax (samplesPerBlock, nativeRateProcessor.getMaxModelBlockSize()));
+    crossfadeChunk.resize ((size_t) numChannels);
+    crossfadePosition = 0;
+    wasAtNativeRate = false;
+
+    // the delay reported from here on is that of the engines that will play
+    auto* activeModels = models.acquire();
+    engineLatency = activeModels != nullptr ? getDistModelBankLatency (*activeModels) : 0;
+    setLatencySamples (getCurrentLatency());
+    loadMonitor.prepare (sampleRate);
+
+    // playback starts from the settled state rather than from zero
+    if (activeModels != nullptr)
+        prewarm (*activeModels);
 }
 
 void DISTNNAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    workers.stop();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -112,12 +201,8 @@ bool DISTNNAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any channel count works: channels are processed in pairs, each pair with its own state.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -133,7 +218,34 @@ bool DISTNNAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
 
 void DISTNNAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    if (func == false){
+    // timed from here to the end against the buffer duration, see getLoadStats()
+    const auto blockStart = loadMonitor.startBlock();
+    const auto denormalHeavy = LoadMonitor::isDenormalHeavy (buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples());
+
+    MeterLevels levels;
+    levels.inputPeak = buffer.getMagnitude (0, buffer.getNumSamples());
+    levels.inputRms = getRmsLevel (buffer);
+
+    DistModelBank* previousModels = nullptr;
+    auto* activeModels = models.acquire (previousModels);
+
+    // the reported delay follows the engines that are playing. Shared and plain
+    // engines are delayed differently, and fading between them would mix two
+    // misaligned signals, so such a switch cuts over instead.
+    if (previousModels != nullptr)
+    {
+        const auto latency = getDistModelBankLatency (*activeModels);
+        engineLatency = latency;
+
+        if (getDistModelBankLatency (*previousModels) != latency)
+        {
+            models.releasePrevious();
+            previousModels = nullptr;
+            crossfadePosition = 0;
+        }
+    }
+
+    if (func == false && activeModels != nullptr){
         
         juce::ScopedNoDenormals noDenormals;
         auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -143,17 +255,129 @@ void DISTNNAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce:
                buffer.clear (i, 0, buffer.getNumSamples());
         
         
-	    float* channelDataL = buffer.getWritePointer(0);
-	    float* channelDataR = buffer.getWritePointer(1);
-        for (int n = 0; n < buffer.getNumSamples(); ++n)
+        // each channel pair runs as the two lanes of one engine, each lane with its own state
+        auto* const* channelData = buffer.getArrayOfWritePointers();
+        const auto numChannels = juce::jmin (totalNumOutputChannels, buffer.getNumChannels());
+        const auto numSamples = buffer.getNumSamples();
+
+        const auto atNativeRate = nativeRateProcessor.isActive() && nativeRate->get();
+
+        // knob moves glide over ~10 ms, at whatever rate the model is running
+        const auto smoothingSamples = juce::jmax (1, juce::roundToInt ((atNativeRate ? distModelSampleRate : hostSampleRate) * 0.01));
+
+        // read once, the editor may change it while the workers run
+        const auto currentEffect = effect;
+        const auto activationQuality = (ActivationQuality) activations->getIndex();
+
+        auto runBank = [&] (DistModelBank& bank, float* const* data, int numDataChannels, int numDataSamples)
+        {
+            // a bank built for another layout can still be in flight, extra channels stay dry
+            const auto numPairs = juce::jmin ((int) bank.size(), (numDataChannels + 1) / 2);
+
+            auto runPair = [&] (int pair)
+            {
+                std::visit ([&] (auto& model)
+                {
+                    model.setSmoothingLength (smoothingSamples);
+                    model.setActivationQuality (activationQuality);
+                    model.process (data + 2 * pair, juce::jmin (2, numDataChannels - 2 * pair), numDataSamples, currentEffect);
+                }, bank[(size_t) pair]);
+            };
+
+            workers.run (numPairs, runPair);
+        };
+
+        // ~30 ms, long enough for the new engines' state to settle and not to click
+        crossfadeLength = smoothingSamples * 3;
+
+        auto runModel = [&] (float* const* data, int numDataChannels, int numDataSamples)
+        {
+            if (previousModels == nullptr)
             {
-                float inputL[] = {channelDataL[n], effect};
-                float inputR[] = {channelDataR[n], effect};
-                channelDataL[n] = model.forward(inputL);
-                channelDataR[n] = model.forward(inputR);
+                runBank (*activeModels, data, numDataChannels, numDataSamples);
+                return;
             }
+
+            // both sets of engines run on the same input until the fade is over
+            auto* const* fadeData = crossfadeBuffer.getArrayOfWritePointers();
+            const auto chunkSize = crossfadeBuffer.getNumSamples();
+
+            for (int start = 0; start < numDataSamples; start += chunkSize)
+            {
+                const auto numInChunk = juce::jmin (chunkSize, numDataSamples - start);
+
+                for (int ch = 0; ch < numDataChannels; ++ch)
+                {
+                    crossfadeChunk[(size_t) ch] = data[ch] + start;
+                    juce::FloatVectorOperations::copy (fadeData[ch], data[ch] + start, numInChunk);
+                }
+
+                runBank (*previousModels, fadeData, numDataChannels, numInChunk);
+                runBank (*activeModels, crossfadeChunk.data(), numDataChannels, numInChunk);
+
+                for (int ch = 0; ch < numDataChannels; ++ch)
+                {
+                    for (int n = 0; n < numInChunk; ++n)
+                    {
+                        const auto fade = juce::jmin (1.0f, (float) (crossfadePosition + n) / (float) crossfadeLength);
+                        crossfadeChunk[(size_t) ch][n] = fadeData[ch][n] + fade * (crossfadeChunk[(size_t) ch][n] - fadeData[ch][n]);
+                    }
+                }
+
+                crossfadePosition += numInChunk;
+            }
+        };
+
+        if (atNativeRate && ! wasAtNativeRate)
+            nativeRateProcessor.reset();
+
+        wasAtNativeRate = atNativeRate;
+
+        if (atNativeRate)
+            nativeRateProcessor.process (channelData, numChannels, numSamples, runModel);
+        else
+            runModel (channelData, numChannels, numSamples);
     
     }
+
+    // the outgoing engines go back to the message thread once faded out (or right away when bypassed)
+    if (previousModels != nullptr && (func || crossfadePosition >= crossfadeLength))
+    {
+        models.releasePrevious();
+        crossfadePosition = 0;
+    }
+
+    levels.outputPeak = buffer.getMagnitude (0, buffer.getNumSamples());
+    levels.outputRms = getRmsLevel (buffer);
+    meterFeed.push (levels);
+
+    loadMonitor.endBlock (blockStart, buffer.getNumSamples(), denormalHeavy);
+}
+
+float DISTNNAudioProcessor::getRmsLevel (const juce::AudioBuffer<float>& buffer)
+{
+    float level = 0.0f;
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        level = juce::jmax (level, buffer.getRMSLevel (ch, 0, buffer.getNumSamples()));
+
+    return level;
+}
+
+bool DISTNNAudioProcessor::readMeterLevels (MeterLevels& levels)
+{
+    MeterLevels block;
+    bool any = false;
+
+    while (meterFeed.pop (block))
+    {
+        levels = any ? MeterLevels { juce::jmax (levels.inputPeak, block.inputPeak), juce::jmax (levels.outputPeak, block.outputPeak),
+                                     juce::jmax (levels.inputRms, block.inputRms), juce::jmax (levels.outputRms, block.outputRms) }
+                     : block;
+        any = true;
+    }
+
+    return any;
 }
 
 //==============================================================================
@@ -170,15 +394,36 @@ juce::AudioProcessorEditor* DISTNNAudioProcessor::createEditor()
 //==============================================================================
 void DISTNNAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    juce::MemoryOutputStream stream (destData, true);
+    stream.writeInt (modelSize->getIndex());
+    stream.writeBool (nativeRate->get());
+    stream.writeBool (adaptiveQuality->get());
+    stream.writeInt (activations->getIndex());
+    stream.writeBool (useModelsDir->get());
+    stream.writeBool (sharedEngine->get());
 }
 
 void DISTNNAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    juce::MemoryInputStream stream (data, (size_t) sizeInBytes, false);
+
+    if (sizeInBytes >= (int) sizeof (int))
+        *modelSize = juce::jlimit (0, numModelSizes - 1, stream.readInt());
+
+    if (! stream.isExhausted())
+        *nativeRate = stream.readBool();
+
+    if (! stream.isExhausted())
+        *adaptiveQuality = stream.readBool();
+
+    if (! stream.isExhausted())
+        *activations = juce::jlimit (0, numActivationQualities - 1, stream.readInt());
+
+    if (! stream.isExhausted())
+        *useModelsDir = stream.readBool();
+
+    if (! stream.isExhausted())
+        *sharedEngine = stream.readBool();
 }
 
 //==============================================================================
@@ -188,16 +433,249 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new DISTNNAudioProcessor();
 }
 
-void DISTNNAudioProcessor::loadModel(MemoryInputStream& jsonStream, RTNeural::ModelT<float, 2, 1, RTNeural::LSTMLayerT<float, 2, 16>, RTNeural::DenseT<float, 16, 1>>& model)
+std::unique_ptr<DistModelVariant> DISTNNAudioProcessor::loadModel(ModelSize size)
+{
+    // the embedded models are in the binary .dnnb format (see TRAIN/convert.cpp),
+    // so this is a header check and at most one copy of the weights, no parsing
+    switch (size)
+    {
+        case ModelSize::hidden8:  return makeDistModel (BinaryData::modelParametricDIST8_dnnb,  (size_t) BinaryData::modelParametricDIST8_dnnbSize);
+        case ModelSize::hidden16: return makeDistModel (BinaryData::modelParametricDIST16_dnnb, (size_t) BinaryData::modelParametricDIST16_dnnbSize);
+        case ModelSize::hidden24: return makeDistModel (BinaryData::modelParametricDIST24_dnnb, (size_t) BinaryData::modelParametricDIST24_dnnbSize);
+        case ModelSize::hidden32: return makeDistModel (BinaryData::modelParametricDIST32_dnnb, (size_t) BinaryData::modelParametricDIST32_dnnbSize);
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<DistModelVariant> DISTNNAudioProcessor::loadModelFile (const juce::File& file)
+{
+    auto data = std::make_shared<juce::MemoryBlock>();
+
+    if (! file.loadFileAsData (*data))
+        return nullptr;
+
+    // any SimpleLSTM export works: the compiled sizes get their static engine, other
+    // sizes the dynamic one. SimpleGRU exports of the compiled sizes run on DistGRU
+    // in builds with DISTNN_GRU.
+    // .dnnb files are used in place, so the engines keep the data.
+    return makeDistModel (static_cast<const char*> (data->getData()), data->getSize(), data);
+}
+
+std::unique_ptr<DistModelBank> DISTNNAudioProcessor::loadModels (const ModelSource& source, int numModelEngines)
 {
-    auto modelJson = nlohmann::json::parse (jsonStream.readEntireStreamAsString().toStdString());
+    if (auto prototype = source.file != juce::File() ? loadModelFile (source.file) : loadModel (source.size))
+        return source.hopSize > 0 ? makeDistSharedModelBank (*prototype, numModelEngines, source.hopSize)
+                                  : makeDistModelBank (*prototype, numModelEngines);
 
-    auto& lstm = model.get<0>();
-    std::string prefix = "lstm.";
-    auto hidden_count = modelJson[prefix + ".weight_ih_l0"].size() / 4;
-    RTNeural::torch_helpers::loadLSTM<float>(modelJson, prefix, lstm);
+    return nullptr;
+}
+
+void DISTNNAudioProcessor::startLoading (const ModelSource& source)
+{
+    // a model that fails to load is not retried until the choice (or the file) changes again
+    loadedSource = source;
+
+    const auto numModelEngines = numEngines;
+    loadingDone.reset();
+
+    modelLoader.addJob ([this, source, numModelEngines]
+    {
+        // a cancelled load is dropped after whichever step it is in
+        auto newModels = loadModels (source, numModelEngines);
+
+        if (newModels != nullptr && ! shouldStopLoading())
+            prewarm (*newModels);
+
+        if (newModels != nullptr)
+        {
+            const juce::ScopedLock lock (readyLock);
+
+            if (! shouldStopLoading())
+                readyModels = std::move (newModels);
+        }
+
+        publishReadyModels();
+        loadingDone.signal();
+    });
+}
 
-    auto& dense = model.get<1>();
-    RTNeural::torch_helpers::loadDense<float>(modelJson, "dense.", dense);
+bool DISTNNAudioProcessor::publishReadyModels()
+{
+    // the loader and the timer both hand banks over, one at a time. The swap
+    // refuses while the audio thread's last swap is still being collected (a
+    // crossfade that ended during the load): the bank then stays here and the
+    // timer tries again, rather than the switch being lost.
+    const juce::ScopedLock lock (readyLock);
+    models.collectGarbage();
+    return readyModels == nullptr || models.publish (readyModels);
+}
+
+bool DISTNNAudioProcessor::isLoading()
+{
+    return modelLoader.getNumJobs() > 0;
+}
+
+bool DISTNNAudioProcessor::waitForLoading (int timeoutMs)
+{
+    return loadingDone.wait (timeoutMs);
 }
 
+bool DISTNNAudioProcessor::cancelLoading (int timeoutMs)
+{
+    // a load that has not started is removed without running, so it cannot signal
+    if (! modelLoader.removeAllJobs (true, timeoutMs))
+        return false;
+
+    loadingDone.signal();
+    return true;
+}
+
+bool DISTNNAudioProcessor::shouldStopLoading()
+{
+    auto* job = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+    return job != nullptr && job->shouldExit();
+}
+
+void DISTNNAudioProcessor::prewarm (DistModelBank& bank)
+{
+    const auto activationQuality = (ActivationQuality) activations->getIndex();
+
+    for (auto& engine : bank)
+        std::visit ([&] (auto& model) { model.setActivationQuality (activationQuality); }, engine);
+
+    prewarmDistModelBank (bank, effect);
+}
+
+void DISTNNAudioProcessor::timerCallback()
+{
+    // anything the audio thread swapped out gets freed here, on the message thread
+    models.collectGarbage();
+
+   #if JUCE_DEBUG
+    // debug builds keep every block's timing in the temp directory, in a file of
+    // each instance's own: the first free one of DIST-NN-load.csv, DIST-NN-load2.csv...
+    // (the timers run one after another, so two instances never pick the same)
+    if (loadLog == nullptr)
+    {
+        const auto logFile = juce::File::getSpecialLocation (juce::File::tempDirectory).getNonexistentChildFile ("DIST-NN-load", ".csv", false);
+        loadLog = logFile.createOutputStream();
+
+        if (loadLog != nullptr)
+            *loadLog << "seconds,load,samples,overrun,denormal_heavy\n";
+    }
+
+    loadMonitor.collect ([this] (const LoadMonitor::BlockTiming& timing)
+    {
+        if (loadLog != nullptr)
+            *loadLog << juce::String (timing.seconds, 9) << "," << juce::String (timing.load, 4) << "," << timing.numSamples
+                     << "," << (int) timing.overrun << "," << (int) timing.denormalHeavy << "\n";
+    });
+
+    if (loadLog != nullptr)
+        loadLog->flush();
+   #else
+    loadMonitor.collect();
+   #endif
+
+    const auto latency = getCurrentLatency();
+
+    if (latency != getLatencySamples())
+        setLatencySamples (latency);
+
+    if (*useModelsDir)
+        pollModelsDir();
+
+    // a bank built during a crossfade goes in first, and nothing new loads until it has
+    if (! publishReadyModels())
+        return;
+
+    const auto requestedSource = getRequestedSource();
+
+    // one load at a time, and only once the previous handover is complete
+    if (requestedSource == loadedSource || isLoading() || ! models.canPublish())
+        return;
+
+    startLoading (requestedSource);
+}
+
+void DISTNNAudioProcessor::pollModelsDir()
+{
+    // about once a second; files modified in the last second are skipped, so a
+    // model that is still being written is not read half way through
+    if (--pollCountdown > 0)
+        return;
+
+    pollCountdown = 10;
+
+    if (! modelsDir.isDirectory())
+        modelsDir.createDirectory();
+
+    const auto now = juce::Time::getCurrentTime();
+    juce::File newest;
+    juce::Time newestTime;
+
+    for (const auto& file : modelsDir.findChildFiles (juce::File::findFiles, false, "*.json;*.dnnb"))
+    {
+        const auto time = file.getLastModificationTime();
+
+        if (now - time >= juce::RelativeTime::seconds (1.0) && (newest == juce::File() || time > newestTime))
+        {
+            newest = file;
+            newestTime = time;
+        }
+    }
+
+    newestModelFile = newest;
+    newestModelTime = newestTime;
+}
+
+DISTNNAudioProcessor::ModelSource DISTNNAudioProcessor::getRequestedSource()
+{
+    ModelSource source;
+    source.size = getRequestedModelSize();
+
+    // the newest file in the models folder replaces the embedded models; saving
+    // over it, or adding a newer one, swaps the new weights in
+    if (*useModelsDir && newestModelFile != juce::File())
+    {
+        source.file = newestModelFile;
+        source.fileTime = newestModelTime;
+    }
+
+    // batched engines trail by two blocks, see DistSharedLSTM
+    if (*sharedEngine)
+        source.hopSize = getSharedHopSize();
+
+    return source;
+}
+
+int DISTNNAudioProcessor::getSharedHopSize() const
+{
+    // one hop per block, at the rate the engines see the audio
+    const auto blockSize = *nativeRate && nativeRateProcessor.isActive() ? nativeRateProcessor.getMaxModelBlockSize() : maxBlockSize;
+    return juce::jmax (1, blockSize);
+}
+
+int DISTNNAudioProcessor::getCurrentLatency() const
+{
+    // the resampling round trip only adds latency while it is switched on
+    if (*nativeRate && nativeRateProcessor.isActive())
+        return nativeRateProcessor.getLatencySamples() + juce::roundToInt (engineLatency * hostSampleRate / distModelSampleRate);
+
+    return engineLatency;
+}
+
+ModelSize DISTNNAudioProcessor::getRequestedModelSize()
+{
+    const auto chosenSize = (ModelSize) modelSize->getIndex();
+
+    if (! *adaptiveQuality)
+        return chosenSize;
+
+    // offline renders have no deadline, so they always get the best model
+    if (isNonRealtime())
+        return ModelSize::hidden32;
+
+    return adaptiveController.update (loadMonitor.getStats(), chosenSize);
+}
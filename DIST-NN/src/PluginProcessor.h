@@ -10,11 +10,19 @@
 
 #include <JuceHeader.h>
 #include <RTNeural/RTNeural.h>
+#include "DistModels.h"
+#include "RealtimeSwap.h"
+#include "NativeRateProcessor.h"
+#include "LoadMonitor.h"
+#include "SpscRing.h"
+#include "RealtimeWorkerPool.h"
+#include "AdaptiveQuality.h"
 
 //==============================================================================
 /**
 */
-class DISTNNAudioProcessor  : public juce::AudioProcessor
+class DISTNNAudioProcessor  : public juce::AudioProcessor,
+                              private juce::Timer
 {
 public:
     //==============================================================================
@@ -54,14 +62,121 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    void loadModel(MemoryInputStream& jsonStream, RTNeural::ModelT<float, 2, 1, RTNeural::LSTMLayerT<float, 2, 16>, RTNeural::DenseT<float, 16, 1>>& model);
+    std::unique_ptr<DistModelVariant> loadModel(ModelSize size);
+    std::unique_ptr<DistModelVariant> loadModelFile (const juce::File& file);
     
     float effect { 0.5 };
     bool func {true};
 
+    juce::AudioParameterChoice* modelSize;
+    juce::AudioParameterBool* nativeRate;
+    juce::AudioParameterBool* adaptiveQuality;
+    juce::AudioParameterChoice* activations;
+    juce::AudioParameterBool* useModelsDir;
+    juce::AudioParameterBool* sharedEngine;
+
+    // processBlock timing, updated on the message thread
+    const LoadMonitor::Stats& getLoadStats() const noexcept { return loadMonitor.getStats(); }
+
+    // linear levels of one block, for the editor's meters
+    struct MeterLevels
+    {
+        float inputPeak = 0.0f, outputPeak = 0.0f, inputRms = 0.0f, outputRms = 0.0f;
+    };
+
+    // Editor side: merges every block since the last call (loudest wins).
+    // Returns false when nothing new arrived.
+    bool readMeterLevels (MeterLevels& levels);
+
 private:
-    RTNeural::ModelT<float, 2, 1, RTNeural::LSTMLayerT<float, 2, 16>, RTNeural::DenseT<float, 16, 1>> model;
+    // what the engines are built from: one of the embedded sizes, or a model file
+    // from modelsDir (then `file` is set, and `fileTime` tells its versions apart).
+    // A hopSize above 0 builds engines that batch with other instances at that hop.
+    struct ModelSource
+    {
+        ModelSize size { ModelSize::hidden16 };
+        juce::File file;
+        juce::Time fileTime;
+        int hopSize { 0 };
+
+        bool operator== (const ModelSource& other) const
+        {
+            return file == other.file && fileTime == other.fileTime && hopSize == other.hopSize
+                && (file != juce::File() || size == other.size);
+        }
+
+        bool operator!= (const ModelSource& other) const { return ! operator== (other); }
+    };
+
+    void timerCallback() override;
+    ModelSize getRequestedModelSize();
+    ModelSource getRequestedSource();
+    void pollModelsDir();
+    int getSharedHopSize() const;
+    int getCurrentLatency() const;
+    std::unique_ptr<DistModelBank> loadModels (const ModelSource& source, int numModelEngines);
+
+    // Builds and pre-warms the engines for `source` on modelLoader, then publishes them.
+    void startLoading (const ModelSource& source);
+    bool isLoading();
+
+    // Both return false when the load is still running after timeoutMs (-1 waits for good).
+    bool waitForLoading (int timeoutMs);
+    bool cancelLoading (int timeoutMs);
+    static bool shouldStopLoading();
+
+    bool publishReadyModels();
+    void prewarm (DistModelBank& bank);
+    static float getRmsLevel (const juce::AudioBuffer<float>& buffer);
+
+    // the engines used by processBlock, one per channel pair; new ones are built
+    // on modelLoader and handed over to the audio thread without locking
+    RealtimeSwap<DistModelBank> models;
+    ModelSource loadedSource;   // the last one requested from modelLoader
+    int numEngines { 1 };
+    int maxBlockSize { 512 };
+
+    // delay of the engines playing (shared ones are two hops late), at the rate they run at;
+    // set by the audio thread when it takes new engines, and by prepareToPlay
+    std::atomic<int> engineLatency { 0 };
+
+    // wide buses spread their channel pairs over these threads
+    RealtimeWorkerPool workers;
+
+    // steps the model size down and up with the load in adaptive mode
+    AdaptiveQuality adaptiveController;
+
+    // model switches crossfade from the outgoing engines to the new ones
+    juce::AudioBuffer<float> crossfadeBuffer;
+    std::vector<float*> crossfadeChunk;
+    int crossfadePosition { 0 }, crossfadeLength { 1 };
+    double hostSampleRate { 44100.0 };
+
+    // resamples to the rate the models were trained at when the session runs at another one
+    NativeRateProcessor nativeRateProcessor;
+    bool wasAtNativeRate { false };
+
+    LoadMonitor loadMonitor;
+
+    // written by processBlock, read by the editor; blocks are dropped while nobody reads
+    SpscRing<MeterLevels, 256> meterFeed;
+   #if JUCE_DEBUG
+    std::unique_ptr<juce::FileOutputStream> loadLog;
+   #endif
     juce::File modelsDir;
+    juce::File newestModelFile;
+    juce::Time newestModelTime;
+    int pollCountdown { 0 };
+
+    // a bank built by modelLoader that could not be handed over yet, see publishReadyModels()
+    std::unique_ptr<DistModelBank> readyModels;
+    juce::CriticalSection readyLock;
+
+    // model loads run here, one at a time, off the message and audio threads;
+    // loadingDone is signalled whenever no load is pending
+    juce::WaitableEvent loadingDone { true };
+    static constexpr int loadWaitMs = 1000;   // longest prepareToPlay blocks on a load
+    juce::ThreadPool modelLoader { 1 };
     //std::unique_ptr<RTNeural::ModelT<float, 1, 1, RTNeural::LSTMLayerT<float, 1, 32>, RTNeural::DenseT<float, 32, 1>>> modelRun[2];
 
     //==============================================================================
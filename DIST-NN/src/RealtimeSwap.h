@@ -0,0 +1,103 @@
+#ifndef RealtimeSwap_h
+#define RealtimeSwap_h
+
+#include <atomic>
+#include <memory>
+
+// Hands objects built on a background/message thread over to the audio thread
+// without locks or allocations on the audio side.
+//
+// - the producer builds a new object and calls publish() once canPublish() is true
+// - the audio thread calls acquire() at the top of every block and uses what it returns
+// - the producer calls collectGarbage() periodically to delete the replaced object
+//
+// There is a single pending slot and a single retired slot, so a producer that
+// publishes faster than the audio thread consumes simply has to wait a block.
+//
+// To crossfade, the audio thread can use acquire (previous) instead: the object
+// being replaced stays alive, audio-side, until it calls releasePrevious().
+template <typename ObjectType>
+class RealtimeSwap
+{
+public:
+    RealtimeSwap() = default;
+
+    ~RealtimeSwap()
+    {
+        delete pending.exchange (nullptr);
+        delete retired.exchange (nullptr);
+    }
+
+    // Sets the current object directly, dropping anything still in flight.
+    // Only safe while the audio thread is not running.
+    void reset (std::unique_ptr<ObjectType> newObject)
+    {
+        delete pending.exchange (nullptr);
+        previous.reset();
+        current = std::move (newObject);
+    }
+
+    bool canPublish() const noexcept
+    {
+        return pending.load (std::memory_order_acquire) == nullptr
+            && retired.load (std::memory_order_acquire) == nullptr;
+    }
+
+    // Producer side. Returns false (and keeps ownership) if the previous handover is still in flight.
+    bool publish (std::unique_ptr<ObjectType>& newObject) noexcept
+    {
+        if (newObject == nullptr || ! canPublish())
+            return false;
+
+        pending.store (newObject.release(), std::memory_order_release);
+        return true;
+    }
+
+    // Audio-thread side: picks up a pending object if there is one and returns the current one.
+    ObjectType* acquire() noexcept
+    {
+        ObjectType* replaced;
+        auto* object = acquire (replaced);
+        releasePrevious();
+        return object;
+    }
+
+    // Audio-thread side, for crossfading: like acquire(), but the object that was
+    // replaced is returned in `replaced` (nullptr if none) and kept alive until
+    // releasePrevious(). No new object is picked up while one is being replaced.
+    ObjectType* acquire (ObjectType*& replaced) noexcept
+    {
+        if (previous == nullptr
+            && pending.load (std::memory_order_acquire) != nullptr
+            && retired.load (std::memory_order_acquire) == nullptr)
+        {
+            auto* next = pending.exchange (nullptr, std::memory_order_acq_rel);
+            previous = std::move (current);
+            current.reset (next);
+        }
+
+        replaced = previous.get();
+        return current.get();
+    }
+
+    // Audio-thread side: hands the replaced object to the producer for deletion.
+    void releasePrevious() noexcept
+    {
+        // the retired slot is always free here: acquire only swaps when it is
+        if (previous != nullptr)
+            retired.store (previous.release(), std::memory_order_release);
+    }
+
+    // Producer side: frees whatever the audio thread has swapped out.
+    void collectGarbage()
+    {
+        delete retired.exchange (nullptr, std::memory_order_acq_rel);
+    }
+
+private:
+    std::unique_ptr<ObjectType> current, previous;
+    std::atomic<ObjectType*> pending { nullptr };
+    std::atomic<ObjectType*> retired { nullptr };
+};
+
+#endif /* RealtimeSwap_h */
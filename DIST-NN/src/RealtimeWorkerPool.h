@@ -0,0 +1,190 @@
+#ifndef RealtimeWorkerPool_h
+#define RealtimeWorkerPool_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined (__x86_64__) || defined (_M_X64) || defined (__i386__) || defined (_M_IX86)
+ #include <immintrin.h>
+#endif
+
+// Pre-spawned helper threads for splitting one audio block into independent tasks
+// (for instance one per channel pair).
+//
+// run() publishes the job through a single atomic word holding a generation and
+// the next task index; the audio thread and the workers all claim task indices
+// from it with compare-exchange until none are left, then the audio thread waits
+// for the tasks the workers took to finish. There are no locks or allocations on
+// the audio side, and the audio thread never waits for a task that has not
+// started: if the workers are asleep it simply runs everything itself, so a late
+// worker costs parallelism, never a deadline.
+//
+// Workers spin for a moment after each job, which catches the tasks of a
+// run() right behind it, and then park on a condition variable, so that idle
+// workers of many instances do not compete with the host's threads for the
+// cores. run() wakes them only when one is parked: a non-blocking notify, the
+// one system call on the audio side. A wake-up that races a worker going to
+// sleep is not lost for longer than the park timeout.
+class RealtimeWorkerPool
+{
+public:
+    RealtimeWorkerPool() = default;
+    ~RealtimeWorkerPool() { stop(); }
+
+    // Stops the current threads and starts `numThreads` new ones.
+    // Call while run() cannot be running (prepareToPlay).
+    void prepare (int numThreads)
+    {
+        stop();
+        shouldExit.store (false, std::memory_order_relaxed);
+
+        for (int i = 0; i < numThreads; ++i)
+            threads.emplace_back ([this] { workerLoop(); });
+    }
+
+    void stop()
+    {
+        {
+            const std::lock_guard<std::mutex> lock (parkLock);
+            shouldExit.store (true, std::memory_order_relaxed);
+        }
+
+        wakeUp.notify_all();
+
+        for (auto& thread : threads)
+            thread.join();
+
+        threads.clear();
+    }
+
+    int getNumThreads() const noexcept { return (int) threads.size(); }
+
+    // Calls task (int index) for every index in [0, numTasks), spread over the
+    // calling thread and the workers, and returns once all of them are done.
+    template <typename TaskFn>
+    void run (int numTasks, TaskFn& task) noexcept
+    {
+        if (threads.empty() || numTasks < 2)
+        {
+            for (int i = 0; i < numTasks; ++i)
+                task (i);
+
+            return;
+        }
+
+        context.store (&task, std::memory_order_relaxed);
+        invoke.store (&invokeTask<TaskFn>, std::memory_order_relaxed);
+        jobSize.store (numTasks, std::memory_order_relaxed);
+        numDone.store (0, std::memory_order_relaxed);
+
+        const auto generation = ++lastGeneration;
+        work.store ((uint64_t) generation << 32, std::memory_order_seq_cst);
+
+        // ordered after the store above, see workerLoop
+        if (numParked.load (std::memory_order_seq_cst) > 0)
+            wakeUp.notify_all();
+
+        runTasks (generation);
+
+        while (numDone.load (std::memory_order_acquire) != numTasks)
+            pause();
+    }
+
+private:
+    template <typename TaskFn>
+    static void invokeTask (void* task, int index) { (*static_cast<TaskFn*> (task)) (index); }
+
+    static void pause() noexcept
+    {
+       #if defined (__x86_64__) || defined (_M_X64) || defined (__i386__) || defined (_M_IX86)
+        _mm_pause();
+       #else
+        std::this_thread::yield();
+       #endif
+    }
+
+    // Claims and runs tasks of the given job until none are left. A stale generation
+    // makes every compare-exchange fail, so a late worker cannot touch a newer job.
+    void runTasks (uint32_t generation) noexcept
+    {
+        auto current = work.load (std::memory_order_acquire);
+
+        while ((uint32_t) (current >> 32) == generation
+               && (int) (uint32_t) current < jobSize.load (std::memory_order_relaxed))
+        {
+            if (work.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                invoke.load (std::memory_order_relaxed) (context.load (std::memory_order_relaxed), (int) (uint32_t) current);
+                numDone.fetch_add (1, std::memory_order_release);
+                current = work.load (std::memory_order_acquire);
+            }
+        }
+    }
+
+    uint32_t getGeneration() const noexcept { return (uint32_t) (work.load (std::memory_order_seq_cst) >> 32); }
+
+    void workerLoop()
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr auto spinPeriod = std::chrono::microseconds (100);
+        constexpr auto parkTimeout = std::chrono::milliseconds (2);
+
+        auto lastJob = Clock::now();
+        uint32_t seen = getGeneration();
+
+        while (! shouldExit.load (std::memory_order_relaxed))
+        {
+            const auto generation = getGeneration();
+
+            if (generation != seen)
+            {
+                seen = generation;
+                runTasks (generation);
+                lastJob = Clock::now();
+            }
+            else if (Clock::now() - lastJob < spinPeriod)
+            {
+                pause();
+            }
+            else
+            {
+                // counted before the generation is checked again: either this
+                // sees the new job, or run() sees the count and notifies
+                numParked.fetch_add (1, std::memory_order_seq_cst);
+
+                {
+                    std::unique_lock<std::mutex> lock (parkLock);
+                    wakeUp.wait_for (lock, parkTimeout, [&]
+                    {
+                        return getGeneration() != seen || shouldExit.load (std::memory_order_relaxed);
+                    });
+                }
+
+                // a timeout without a job parks again right away
+                numParked.fetch_sub (1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> shouldExit { false };
+
+    // the job: generation in the high half, next unclaimed task in the low half
+    alignas (64) std::atomic<uint64_t> work { 0 };
+    alignas (64) std::atomic<int> numDone { 0 };
+    std::atomic<int> jobSize { 0 };
+    std::atomic<void*> context { nullptr };
+    std::atomic<void (*) (void*, int)> invoke { nullptr };
+    uint32_t lastGeneration = 0;
+
+    std::atomic<int> numParked { 0 };
+    std::mutex parkLock;
+    std::condition_variable wakeUp;
+};
+
+#endif /* RealtimeWorkerPool_h */
@@ -0,0 +1,48 @@
+#ifndef SpscRing_h
+#define SpscRing_h
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Wait-free single producer / single consumer ring. push() never blocks: it
+// returns false when the consumer has fallen behind and the ring is full.
+template <typename T, size_t capacity>
+class SpscRing
+{
+    static_assert ((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    bool push (const T& item) noexcept
+    {
+        const auto write = writeIndex.load (std::memory_order_relaxed);
+
+        if (write - readIndex.load (std::memory_order_acquire) == capacity)
+            return false;
+
+        items[write & (capacity - 1)] = item;
+        writeIndex.store (write + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop (T& item) noexcept
+    {
+        const auto read = readIndex.load (std::memory_order_relaxed);
+
+        if (read == writeIndex.load (std::memory_order_acquire))
+            return false;
+
+        item = items[read & (capacity - 1)];
+        readIndex.store (read + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, capacity> items {};
+
+    // on separate cache lines, so the two threads do not keep stealing each other's line
+    alignas (64) std::atomic<size_t> writeIndex { 0 };
+    alignas (64) std::atomic<size_t> readIndex { 0 };
+};
+
+#endif /* SpscRing_h */
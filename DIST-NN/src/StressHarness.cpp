@@ -0,0 +1,397 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless stress test for the plug in itself: N DISTNNAudioProcessor instances,
+// prepared and driven through processBlock the way a host does, from a simulated
+// audio callback that has to finish within one buffer period. The instances are
+// spread over a number of callback threads like a host's parallel graph (the
+// calling thread plus RealtimeWorkerPool workers).
+//
+// For every sample rate, buffer size and thread count it either runs the given
+// instance counts, or searches for the largest count whose deadline-miss rate
+// stays within --max-miss (doubling, then bisecting), and writes one CSV row per
+// run:
+//
+//   rate,block,threads,instances,callbacks,misses,miss_rate,mean_load,max_load
+//
+// load is callback time over the buffer period, so a miss is a load above
+// --budget. The summary gives the largest usable count and that count per thread,
+// which is instances per core as long as --threads stays within the core count.
+//
+// Callbacks are paced in real time by default, so that the caches and the
+// workers cool down between buffers as they would in a session; --no-pace runs
+// them back to back, which is quicker but optimistic.
+
+namespace
+{
+struct StressSettings
+{
+    std::vector<int> sampleRates { 44100, 48000, 96000 };
+    std::vector<int> blockSizes { 64, 128, 256, 512 };
+    std::vector<int> threadCounts { 1 };
+    std::vector<int> instanceCounts;   // empty: search for the largest usable count
+    int maxInstances = 512;
+    int modelIndex = 1;                // 16
+    ActivationQuality activations = defaultActivationQuality;
+    bool nativeRate = true;
+    bool shared = false;
+    double seconds = 5.0;
+    double warmUpSeconds = 0.5;
+    double budget = 1.0;
+    double maxMissRate = 0.001;
+    bool pace = true;
+    std::string outputPath;
+};
+
+struct RunResult
+{
+    int numCallbacks = 0, numMisses = 0;
+    double meanLoad = 0.0, maxLoad = 0.0;
+
+    double getMissRate() const { return numCallbacks > 0 ? (double) numMisses / (double) numCallbacks : 0.0; }
+};
+
+void printUsage()
+{
+    std::cout << "usage: DIST-NN-stress [options]\n"
+                 "  --rates <list>       sample rates, comma separated (default 44100,48000,96000)\n"
+                 "  --blocks <list>      buffer sizes (default 64,128,256,512)\n"
+                 "  --threads <list>     callback threads the instances are spread over (default 1)\n"
+                 "  --instances <list>   instance counts to run (default: search for the largest usable one)\n"
+                 "  --max-instances <n>  upper limit of the search (default 512)\n"
+                 "  --model <8|16|24|32> model size (default 16)\n"
+                 "  --activations <exact|high|medium|fast>\n"
+                 "                       gate activation tier (default "
+              << getActivationQualityName (defaultActivationQuality) << ")\n"
+                 "  --host-rate          run the models at the session rate instead of resampling to 44.1 kHz\n"
+                 "  --shared             batch the instances through a shared engine\n"
+                 "  --seconds <s>        simulated audio per run (default 5)\n"
+                 "  --warmup <s>         callbacks left out of the statistics at the start (default 0.5)\n"
+                 "  --budget <0..1>      share of the buffer period the plug ins may use (default 1)\n"
+                 "  --max-miss <x>       miss rate still counted as usable (default 0.001)\n"
+                 "  --no-pace            run the callbacks back to back instead of in real time\n"
+                 "  --out <file.csv>     also write the rows to a CSV file\n";
+}
+
+std::vector<int> parseList (const std::string& text)
+{
+    std::vector<int> values;
+    std::stringstream stream (text);
+    std::string item;
+
+    while (std::getline (stream, item, ','))
+        values.push_back (std::stoi (item));
+
+    return values;
+}
+
+bool parseArguments (int argc, char* argv[], StressSettings& settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto hasValue = i + 1 < argc;
+
+        if (arg == "--rates" && hasValue)              settings.sampleRates = parseList (argv[++i]);
+        else if (arg == "--blocks" && hasValue)        settings.blockSizes = parseList (argv[++i]);
+        else if (arg == "--threads" && hasValue)       settings.threadCounts = parseList (argv[++i]);
+        else if (arg == "--instances" && hasValue)     settings.instanceCounts = parseList (argv[++i]);
+        else if (arg == "--max-instances" && hasValue) settings.maxInstances = std::stoi (argv[++i]);
+        else if (arg == "--model" && hasValue)
+        {
+            const auto hiddenSize = std::stoi (argv[++i]);
+
+            if (hiddenSize % 8 != 0 || hiddenSize < 8 || hiddenSize > 8 * numModelSizes)
+                return false;
+
+            settings.modelIndex = hiddenSize / 8 - 1;
+        }
+        else if (arg == "--activations" && hasValue)
+        {
+            if (! getActivationQuality (argv[++i], settings.activations))
+                return false;
+        }
+        else if (arg == "--host-rate")                 settings.nativeRate = false;
+        else if (arg == "--shared")                    settings.shared = true;
+        else if (arg == "--seconds" && hasValue)       settings.seconds = std::stod (argv[++i]);
+        else if (arg == "--warmup" && hasValue)        settings.warmUpSeconds = std::stod (argv[++i]);
+        else if (arg == "--budget" && hasValue)        settings.budget = std::stod (argv[++i]);
+        else if (arg == "--max-miss" && hasValue)      settings.maxMissRate = std::stod (argv[++i]);
+        else if (arg == "--no-pace")                   settings.pace = false;
+        else if (arg == "--out" && hasValue)           settings.outputPath = argv[++i];
+        else return false;
+    }
+
+    for (const auto* list : { &settings.sampleRates, &settings.blockSizes, &settings.threadCounts })
+        if (list->empty() || *std::min_element (list->begin(), list->end()) < 1)
+            return false;
+
+    return settings.seconds > settings.warmUpSeconds && settings.maxInstances >= 1;
+}
+
+// a guitar-like pluck every half second on some noise, so the models never sit
+// on silence (where they would skip the work); every instance reads it from its
+// own offset
+juce::AudioBuffer<float> makeTestSignal (int sampleRate, int numSamples)
+{
+    juce::AudioBuffer<float> signal (2, numSamples);
+    juce::Random random (12345);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto t = (float) (n % (sampleRate / 2)) / (float) sampleRate;
+            const auto pluck = 0.6f * std::exp (-4.0f * t) * std::sin (2.0f * juce::MathConstants<float>::pi * 110.0f * (float) (ch + 1) * t);
+            signal.setSample (ch, n, pluck + 0.01f * (random.nextFloat() - 0.5f));
+        }
+    }
+
+    return signal;
+}
+
+class StressRig
+{
+public:
+    explicit StressRig (const StressSettings& settingsToUse) : settings (settingsToUse) {}
+
+    RunResult run (int sampleRate, int blockSize, int numThreads, int numInstances)
+    {
+        prepare (sampleRate, blockSize, numThreads, numInstances);
+
+        using Clock = std::chrono::steady_clock;
+        const auto period = std::chrono::duration<double> ((double) blockSize / (double) sampleRate);
+        const auto numCallbacks = (int) (settings.seconds * sampleRate / blockSize);
+        const auto numWarmUp = (int) (settings.warmUpSeconds * sampleRate / blockSize);
+
+        auto processInstance = [&] (int index)
+        {
+            auto& instance = instances[(size_t) index];
+            const auto start = instance.position;
+
+            for (int ch = 0; ch < 2; ++ch)
+                instance.buffer.copyFrom (ch, 0, testSignal, ch, start, blockSize);
+
+            instance.position = start + blockSize > testSignal.getNumSamples() - blockSize ? 0 : start + blockSize;
+            instance.processor->processBlock (instance.buffer, instance.midi);
+        };
+
+        RunResult result;
+        double totalLoad = 0.0;
+        auto nextCallback = Clock::now();
+
+        for (int i = 0; i < numCallbacks; ++i)
+        {
+            // a host that overran starts the next buffer straight away
+            if (settings.pace)
+                std::this_thread::sleep_until (nextCallback);
+
+            const auto callbackStart = Clock::now();
+            callbackThreads.run (numInstances, processInstance);
+            const auto load = std::chrono::duration<double> (Clock::now() - callbackStart) / period;
+
+            nextCallback = std::max (nextCallback + std::chrono::duration_cast<Clock::duration> (period), Clock::now());
+
+            if (i < numWarmUp)
+                continue;
+
+            ++result.numCallbacks;
+            result.numMisses += load > settings.budget ? 1 : 0;
+            result.maxLoad = std::max (result.maxLoad, load);
+            totalLoad += load;
+        }
+
+        result.meanLoad = result.numCallbacks > 0 ? totalLoad / result.numCallbacks : 0.0;
+        return result;
+    }
+
+private:
+    struct Instance
+    {
+        std::unique_ptr<DISTNNAudioProcessor> processor;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        int position = 0;
+    };
+
+    void prepare (int sampleRate, int blockSize, int numThreads, int numInstances)
+    {
+        // one second, or a few buffers of the largest sizes
+        const auto signalLength = std::max (sampleRate, 4 * blockSize);
+
+        if (sampleRate != testSignalRate || signalLength != testSignal.getNumSamples())
+        {
+            testSignal = makeTestSignal (sampleRate, signalLength);
+            testSignalRate = sampleRate;
+        }
+
+        // instances are kept between runs, like a session that grows; the ones
+        // past numInstances are released and sit idle
+        while ((int) instances.size() < numInstances)
+        {
+            Instance instance;
+            instance.processor = std::make_unique<DISTNNAudioProcessor>();
+
+            auto& processor = *instance.processor;
+            *processor.modelSize = settings.modelIndex;
+            *processor.activations = (int) settings.activations;
+            *processor.nativeRate = settings.nativeRate;
+            *processor.sharedEngine = settings.shared;
+            processor.effect = 0.5f + 0.4f * std::sin ((float) instances.size());
+            processor.func = false;
+
+            instances.push_back (std::move (instance));
+        }
+
+        for (int i = 0; i < (int) instances.size(); ++i)
+        {
+            auto& instance = instances[(size_t) i];
+
+            if (i >= numInstances)
+            {
+                instance.processor->releaseResources();
+                continue;
+            }
+
+            instance.processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+            instance.processor->prepareToPlay (sampleRate, blockSize);
+            instance.buffer.setSize (2, blockSize);
+            instance.position = (i * 7919) % (signalLength - 2 * blockSize);
+        }
+
+        callbackThreads.prepare (numThreads - 1);
+    }
+
+    const StressSettings& settings;
+    std::vector<Instance> instances;
+    juce::AudioBuffer<float> testSignal;
+    int testSignalRate = 0;
+    RealtimeWorkerPool callbackThreads;
+};
+
+void writeRow (std::ostream& stream, int sampleRate, int blockSize, int numThreads, int numInstances, const RunResult& result)
+{
+    stream << sampleRate << "," << blockSize << "," << numThreads << "," << numInstances << "," << result.numCallbacks << ","
+           << result.numMisses << "," << result.getMissRate() << "," << result.meanLoad << "," << result.maxLoad << "\n";
+}
+}
+
+int main (int argc, char* argv[])
+{
+    StressSettings settings;
+    bool validArguments = false;
+
+    try
+    {
+        validArguments = parseArguments (argc, argv, settings);
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    if (! validArguments)
+    {
+        printUsage();
+        return 1;
+    }
+
+    // the processors start timers and load models on background threads
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    std::ofstream csv;
+
+    if (! settings.outputPath.empty())
+    {
+        csv.open (settings.outputPath);
+
+        if (! csv)
+        {
+            std::cerr << "could not write " << settings.outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    const auto* header = "rate,block,threads,instances,callbacks,misses,miss_rate,mean_load,max_load\n";
+    std::cout << header;
+    csv << header;
+
+    std::stringstream summary;
+    StressRig rig (settings);
+
+    for (const auto sampleRate : settings.sampleRates)
+    {
+        for (const auto blockSize : settings.blockSizes)
+        {
+            for (const auto numThreads : settings.threadCounts)
+            {
+                int maxUsable = 0;
+
+                auto runOnce = [&] (int numInstances)
+                {
+                    const auto result = rig.run (sampleRate, blockSize, numThreads, numInstances);
+                    writeRow (std::cout, sampleRate, blockSize, numThreads, numInstances, result);
+                    writeRow (csv, sampleRate, blockSize, numThreads, numInstances, result);
+
+                    const auto usable = result.getMissRate() <= settings.maxMissRate;
+
+                    if (usable)
+                        maxUsable = std::max (maxUsable, numInstances);
+
+                    return usable;
+                };
+
+                if (! settings.instanceCounts.empty())
+                {
+                    for (const auto numInstances : settings.instanceCounts)
+                        runOnce (numInstances);
+                }
+                else
+                {
+                    // double until the first miss-heavy count, then bisect below it
+                    int good = 0, bad = settings.maxInstances + 1;
+
+                    for (int n = 1;; n = std::min (2 * n, settings.maxInstances))
+                    {
+                        if (! runOnce (n))
+                        {
+                            bad = n;
+                            break;
+                        }
+
+                        good = n;
+
+                        if (n == settings.maxInstances)
+                            break;
+                    }
+
+                    while (bad - good > 1 && bad <= settings.maxInstances)
+                    {
+                        const auto middle = (good + bad) / 2;
+
+                        if (runOnce (middle))
+                            good = middle;
+                        else
+                            bad = middle;
+                    }
+                }
+
+                summary << sampleRate << " Hz, " << blockSize << " samples, " << numThreads << (numThreads == 1 ? " thread: " : " threads: ")
+                        << maxUsable << " instances (" << (double) maxUsable / numThreads << " per thread)\n";
+            }
+        }
+    }
+
+    std::cout << "\nlargest instance count with a miss rate within " << settings.maxMissRate << " (" << std::thread::hardware_concurrency()
+              << " cores):\n" << summary.str();
+    return 0;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Minimal streaming WAV reader/writer for the offline tools. Files are read and
+// written a block at a time so arbitrarily long renders use a fixed amount of
+// memory. Reads 16/24/32-bit PCM and 32-bit float, writes 32-bit float.
+// Assumes a little-endian host, like every platform we build on.
+
+class WavReader
+{
+public:
+    bool open (const std::string& path)
+    {
+        stream.open (path, std::ios::binary);
+
+        if (! stream)
+            return fail ("cannot open " + path);
+
+        char riff[12];
+
+        if (! stream.read (riff, 12) || std::memcmp (riff, "RIFF", 4) != 0 || std::memcmp (riff + 8, "WAVE", 4) != 0)
+            return fail (path + " is not a RIFF/WAVE file");
+
+        bool gotFormat = false;
+
+        for (;;)
+        {
+            char chunkId[4];
+            uint32_t chunkSize = 0;
+
+            if (! stream.read (chunkId, 4) || ! stream.read (reinterpret_cast<char*> (&chunkSize), 4))
+                return fail (path + " has no data chunk");
+
+            if (std::memcmp (chunkId, "fmt ", 4) == 0)
+            {
+                std::vector<char> fmt (std::max<uint32_t> (chunkSize, 16));
+                stream.read (fmt.data(), chunkSize);
+
+                // chunks are padded to an even size
+                if ((chunkSize & 1) != 0)
+                    stream.seekg (1, std::ios::cur);
+
+                uint16_t formatTag, channels, bits;
+                uint32_t rate;
+                std::memcpy (&formatTag, fmt.data(), 2);
+                std::memcpy (&channels, fmt.data() + 2, 2);
+                std::memcpy (&rate, fmt.data() + 4, 4);
+                std::memcpy (&bits, fmt.data() + 14, 2);
+
+                // WAVE_FORMAT_EXTENSIBLE keeps the real format in the sub-format GUID
+                if (formatTag == 0xfffe && chunkSize >= 26)
+                    std::memcpy (&formatTag, fmt.data() + 24, 2);
+
+                isFloat = formatTag == 3;
+
+                if (! ((formatTag == 1 && (bits == 16 || bits == 24 || bits == 32)) || (isFloat && bits == 32)))
+                    return fail (path + ": unsupported sample format");
+
+                numChannels = channels;
+                sampleRate = (double) rate;
+                bytesPerSample = bits / 8;
+                gotFormat = true;
+            }
+            else if (std::memcmp (chunkId, "data", 4) == 0)
+            {
+                if (! gotFormat || numChannels == 0)
+                    return fail (path + ": data chunk before fmt chunk");
+
+                lengthInFrames = chunkSize / (uint32_t) (bytesPerSample * numChannels);
+                framesLeft = lengthInFrames;
+                return true;
+            }
+            else
+            {
+                stream.seekg (chunkSize + (chunkSize & 1), std::ios::cur);
+            }
+        }
+    }
+
+    // Reads up to numFrames de-interleaved frames and returns how many were read.
+    int read (float* const* channels, int numFrames)
+    {
+        const auto framesToRead = (int) std::min<uint64_t> ((uint64_t) numFrames, framesLeft);
+        const auto frameBytes = (size_t) (bytesPerSample * numChannels);
+
+        raw.resize ((size_t) framesToRead * frameBytes);
+        stream.read (raw.data(), (std::streamsize) raw.size());
+
+        const auto framesRead = (int) ((size_t) stream.gcount() / frameBytes);
+        framesLeft -= (uint64_t) framesRead;
+
+        for (int n = 0; n < framesRead; ++n)
+            for (int ch = 0; ch < numChannels; ++ch)
+                channels[ch][n] = decode (raw.data() + (size_t) n * frameBytes + (size_t) (ch * bytesPerSample));
+
+        return framesRead;
+    }
+
+    int getNumChannels() const { return numChannels; }
+    double getSampleRate() const { return sampleRate; }
+    uint64_t getLengthInFrames() const { return lengthInFrames; }
+    const std::string& getError() const { return error; }
+
+private:
+    bool fail (const std::string& message)
+    {
+        error = message;
+        return false;
+    }
+
+    float decode (const char* p) const
+    {
+        if (isFloat)
+        {
+            float value;
+            std::memcpy (&value, p, 4);
+            return value;
+        }
+
+        switch (bytesPerSample)
+        {
+            case 2:
+            {
+                int16_t value;
+                std::memcpy (&value, p, 2);
+                return (float) value / 32768.0f;
+            }
+            case 3:
+            {
+                const auto value = (int32_t) ((uint32_t) (uint8_t) p[0] << 8 | (uint32_t) (uint8_t) p[1] << 16 | (uint32_t) (uint8_t) p[2] << 24);
+                return (float) (value >> 8) / 8388608.0f;
+            }
+            default:
+            {
+                int32_t value;
+                std::memcpy (&value, p, 4);
+                return (float) ((double) value / 2147483648.0);
+            }
+        }
+    }
+
+    std::ifstream stream;
+    std::vector<char> raw;
+    std::string error;
+    int numChannels = 0, bytesPerSample = 0;
+    bool isFloat = false;
+    double sampleRate = 0.0;
+    uint64_t lengthInFrames = 0, framesLeft = 0;
+};
+
+class WavWriter
+{
+public:
+    ~WavWriter() { close(); }
+
+    bool open (const std::string& path, int channels, double rate)
+    {
+        stream.open (path, std::ios::binary | std::ios::trunc);
+        numChannels = channels;
+        sampleRate = rate;
+        dataBytes = 0;
+
+        if (! stream)
+            return false;
+
+        writeHeader();
+        return (bool) stream;
+    }
+
+    bool write (const float* const* channels, int numFrames)
+    {
+        raw.resize ((size_t) numFrames * (size_t) numChannels);
+
+        for (int n = 0; n < numFrames; ++n)
+            for (int ch = 0; ch < numChannels; ++ch)
+                raw[(size_t) (n * numChannels + ch)] = channels[ch][n];
+
+        stream.write (reinterpret_cast<const char*> (raw.data()), (std::streamsize) (raw.size() * sizeof (float)));
+        dataBytes += (uint32_t) (raw.size() * sizeof (float));
+        return (bool) stream;
+    }
+
+    // Patches the chunk sizes, which are only known once everything has been written.
+    bool close()
+    {
+        if (! stream.is_open())
+            return true;
+
+        stream.seekp (0);
+        writeHeader();
+        const auto ok = (bool) stream;
+        stream.close();
+        return ok;
+    }
+
+private:
+    template <typename T>
+    void put (T value) { stream.write (reinterpret_cast<const char*> (&value), sizeof (T)); }
+
+    void writeHeader()
+    {
+        const auto blockAlign = (uint16_t) (numChannels * 4);
+
+        stream.write ("RIFF", 4);
+        put<uint32_t> (36 + dataBytes);
+        stream.write ("WAVEfmt ", 8);
+        put<uint32_t> (16);
+        put<uint16_t> (3); // IEEE float
+        put<uint16_t> ((uint16_t) numChannels);
+        put<uint32_t> ((uint32_t) sampleRate);
+        put<uint32_t> ((uint32_t) sampleRate * blockAlign);
+        put<uint16_t> (blockAlign);
+        put<uint16_t> (32);
+        stream.write ("data", 4);
+        put<uint32_t> (dataBytes);
+    }
+
+    std::ofstream stream;
+    std::vector<float> raw;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    uint32_t dataBytes = 0;
+};
@@ -0,0 +1,238 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "DistModels.h"
+
+// Inference benchmark for the DIST-NN models. For every model size, block size
+// and channel layout it times the plain RTNeural ModelT (one model per channel,
+// which is how the plugin used to run) against the lane-parallel DistLSTM engine,
+// and writes one CSV row per configuration:
+//
+//   backend,engine,hidden,channels,block,ns_per_sample,realtime_factor
+//
+// ns_per_sample is per sample frame (all channels), realtime_factor is compute
+// time over audio time at 44.1 kHz, so lower is better and 1.0 is the limit.
+// The RTNeural backend is chosen when configuring (see run_benchmarks.sh).
+
+#if RTNEURAL_USE_EIGEN
+static const char* backendName = "eigen";
+#elif RTNEURAL_USE_XSIMD
+static const char* backendName = "xsimd";
+#else
+static const char* backendName = "stl";
+#endif
+
+namespace
+{
+constexpr double benchSampleRate = 44100.0;
+
+struct BenchSettings
+{
+    std::string modelsDir = "../DIST-NN/Models";
+    std::string outputPath;
+    double secondsPerRun = 2.0;
+};
+
+struct Result
+{
+    double nsPerSample;
+    double realtimeFactor;
+};
+
+std::vector<float> makeTestSignal (int numSamples, int channel)
+{
+    // a decaying pluck on top of some noise, so the LSTM does not sit on a fixed point
+    std::vector<float> signal ((size_t) numSamples);
+    uint32_t seed = 12345u + (uint32_t) channel;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const auto noise = (float) (seed >> 8) / 16777216.0f - 0.5f;
+        const auto t = (float) (n % 22050) / (float) benchSampleRate;
+        signal[(size_t) n] = 0.6f * std::exp (-4.0f * t) * std::sin (2.0f * 3.14159265f * 110.0f * t * (float) (channel + 1)) + 0.01f * noise;
+    }
+
+    return signal;
+}
+
+// Runs `processBlock` over the test signal, block by block, until at least
+// secondsPerRun of audio have been processed, and returns the timing.
+template <typename ProcessFn>
+Result timeRun (ProcessFn&& processBlock, int numChannels, int blockSize, double secondsPerRun)
+{
+    const auto signalLength = 1 << 16;
+    std::vector<std::vector<float>> source, work;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        source.push_back (makeTestSignal (signalLength, ch));
+        work.emplace_back ((size_t) blockSize);
+    }
+
+    std::vector<float*> channels;
+
+    for (auto& buffer : work)
+        channels.push_back (buffer.data());
+
+    const auto totalSamples = (long long) (secondsPerRun * benchSampleRate);
+    long long processed = 0;
+    int position = 0;
+    double seconds = 0.0;
+
+    while (processed < totalSamples)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < blockSize; ++n)
+                work[(size_t) ch][(size_t) n] = source[(size_t) ch][(size_t) ((position + n) % signalLength)];
+
+        const auto start = std::chrono::steady_clock::now();
+        processBlock (channels.data(), blockSize);
+        seconds += std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+        position = (position + blockSize) % signalLength;
+        processed += blockSize;
+    }
+
+    return { seconds * 1.0e9 / (double) processed, seconds / ((double) processed / benchSampleRate) };
+}
+
+template <int hiddenSize>
+void benchmarkModel (const nlohmann::json& modelJson, const BenchSettings& settings, std::ostream& out)
+{
+    const auto weights = loadDistWeights<hiddenSize> (modelJson);
+
+    if (weights == nullptr)
+        return;
+
+    const float effect = 0.5f;
+
+    for (int numChannels = 1; numChannels <= 2; ++numChannels)
+    {
+        for (int blockSize = 16; blockSize <= 4096; blockSize *= 2)
+        {
+            auto writeRow = [&] (const char* engine, const Result& result)
+            {
+                out << backendName << ',' << engine << ',' << hiddenSize << ',' << numChannels << ',' << blockSize << ','
+                    << result.nsPerSample << ',' << result.realtimeFactor << '\n';
+            };
+
+            {
+                std::vector<std::unique_ptr<DistModelT<hiddenSize>>> models;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    models.push_back (std::make_unique<DistModelT<hiddenSize>>());
+                    loadDistModel (modelJson, *models.back());
+                }
+
+                writeRow ("rtneural", timeRun ([&] (float* const* channels, int numSamples)
+                {
+                    for (int ch = 0; ch < numChannels; ++ch)
+                    {
+                        auto& model = *models[(size_t) ch];
+
+                        for (int n = 0; n < numSamples; ++n)
+                        {
+                            const float input[] = { channels[ch][n], effect };
+                            channels[ch][n] = model.forward (input);
+                        }
+                    }
+                }, numChannels, blockSize, settings.secondsPerRun));
+            }
+
+            if (numChannels == 1)
+            {
+                DistLSTM<hiddenSize, 1> engine (weights);
+                writeRow ("distlstm", timeRun ([&] (float* const* channels, int numSamples)
+                {
+                    engine.process (channels, 1, numSamples, effect);
+                }, numChannels, blockSize, settings.secondsPerRun));
+            }
+            else
+            {
+                DistLSTM<hiddenSize, 2> engine (weights);
+                writeRow ("distlstm", timeRun ([&] (float* const* channels, int numSamples)
+                {
+                    engine.process (channels, 2, numSamples, effect);
+                }, numChannels, blockSize, settings.secondsPerRun));
+            }
+        }
+    }
+}
+
+bool loadJson (const std::string& path, nlohmann::json& modelJson)
+{
+    std::ifstream jsonStream (path, std::ifstream::binary);
+
+    if (! jsonStream)
+        return false;
+
+    try
+    {
+        jsonStream >> modelJson;
+        return true;
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        return false;
+    }
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    BenchSettings settings;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--models")       settings.modelsDir = argv[i + 1];
+        else if (arg == "--out")     settings.outputPath = argv[i + 1];
+        else if (arg == "--seconds") settings.secondsPerRun = std::stod (argv[i + 1]);
+        else
+        {
+            std::cerr << "usage: distnn-bench [--models <dir>] [--out <results.csv>] [--seconds <audio per run>]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+
+    if (! settings.outputPath.empty())
+        file.open (settings.outputPath);
+
+    std::ostream& out = settings.outputPath.empty() ? std::cout : file;
+    out << "backend,engine,hidden,channels,block,ns_per_sample,realtime_factor\n";
+
+    for (int i = 0; i < numModelSizes; ++i)
+    {
+        const auto hiddenSize = getHiddenSize ((ModelSize) i);
+        const auto path = settings.modelsDir + "/modelParametricDIST" + std::to_string (hiddenSize) + ".json";
+        nlohmann::json modelJson;
+
+        if (! loadJson (path, modelJson))
+        {
+            std::cerr << "skipping " << path << std::endl;
+            continue;
+        }
+
+        switch ((ModelSize) i)
+        {
+            case ModelSize::hidden8:  benchmarkModel<8>  (modelJson, settings, out); break;
+            case ModelSize::hidden16: benchmarkModel<16> (modelJson, settings, out); break;
+            case ModelSize::hidden24: benchmarkModel<24> (modelJson, settings, out); break;
+            case ModelSize::hidden32: benchmarkModel<32> (modelJson, settings, out); break;
+        }
+
+        out.flush();
+    }
+
+    return 0;
+}
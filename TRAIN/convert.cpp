@@ -0,0 +1,116 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "DistModels.h"
+
+// Converts the JSON written by SimpleLSTM or SimpleGRU.save_for_rtneural (or any of the
+// modelParametricDIST*.json files) into the binary .dnnb format the plugin
+// embeds, so instantiating it does not have to parse decimal text.
+//
+// usage: distnn-convert [--precision float32|float16|int8] model.json [more.json ...]
+//        -> model.dnnb (model.float16.dnnb, model.int8.dnnb) next to each input
+//
+// float16 halves the file size and is converted back to float on load; int8
+// stores weight_hh with per-row scales and makes the plugin run its int8 engine.
+// There is no int8 GRU engine, so GRU models are written as float32 or float16.
+// Check a reduced-precision model against the float one with distnn-parity.
+
+namespace fs = std::filesystem;
+
+static bool convert (const fs::path& input, uint32_t precision)
+{
+    std::ifstream jsonStream (input, std::ifstream::binary);
+    nlohmann::json modelJson;
+
+    try
+    {
+        jsonStream >> modelJson;
+    }
+    catch (const nlohmann::json::exception& e)
+    {
+        std::cerr << input.string() << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    ModelSize size;
+    const auto isGru = modelJson.contains ("gru.weight_ih_l0");
+    const auto* firstKey = isGru ? "gru.weight_ih_l0" : "lstm.weight_ih_l0";
+
+    if (! modelJson.contains (firstKey) || ! getModelSize ((int) modelJson[firstKey].size() / (isGru ? 3 : 4), size))
+    {
+        std::cerr << input.string() << ": not an 8/16/24/32 hidden DIST-NN LSTM or GRU model" << std::endl;
+        return false;
+    }
+
+    if (isGru && precision == DistModelFileHeader::int8)
+    {
+        std::cerr << input.string() << ": GRU models have no int8 engine, use float32 or float16" << std::endl;
+        return false;
+    }
+
+    const auto file = withHiddenSize (size, [&] (auto hiddenSize)
+    {
+        if (isGru)
+        {
+            const auto weights = loadDistGRUWeights<hiddenSize> (modelJson);
+            return weights != nullptr ? writeDistModelFile (*weights, precision) : std::vector<char>();
+        }
+
+        const auto weights = loadDistWeights<hiddenSize> (modelJson);
+        return weights != nullptr ? writeDistModelFile (*weights, precision) : std::vector<char>();
+    });
+
+    if (file.empty())
+    {
+        std::cerr << input.string() << ": unexpected weight shapes" << std::endl;
+        return false;
+    }
+
+    auto output = input;
+    output.replace_extension (precision == DistModelFileHeader::int8      ? ".int8.dnnb"
+                            : precision == DistModelFileHeader::float16   ? ".float16.dnnb"
+                                                                          : ".dnnb");
+
+    std::ofstream out (output, std::ios::binary | std::ios::trunc);
+    out.write (file.data(), (std::streamsize) file.size());
+
+    if (! out)
+    {
+        std::cerr << "cannot write " << output.string() << std::endl;
+        return false;
+    }
+
+    std::cout << input.string() << " -> " << output.string() << " (" << file.size() << " bytes)" << std::endl;
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    uint32_t precision = DistModelFileHeader::float32;
+    int firstInput = 1;
+
+    if (argc > 2 && std::string (argv[1]) == "--precision")
+    {
+        const std::string name = argv[2];
+        firstInput = 3;
+
+        if (name == "float16")     precision = DistModelFileHeader::float16;
+        else if (name == "int8")   precision = DistModelFileHeader::int8;
+        else if (name != "float32") firstInput = argc;
+    }
+
+    if (firstInput >= argc)
+    {
+        std::cerr << "usage: distnn-convert [--precision float32|float16|int8] model.json [more.json ...]" << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+
+    for (int i = firstInput; i < argc; ++i)
+        ok = convert (argv[i], precision) && ok;
+
+    return ok ? 0 : 1;
+}
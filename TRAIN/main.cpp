@@ -1,56 +1,490 @@
-#include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
-#include <RTNeural/RTNeural.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DistModels.h"
+#include "WavFile.h"
+
+// Offline renderer for the DIST-NN models: runs WAV files through any of the
+// exported models (modelParametricDIST8/16/24/32.json or your own training run)
+// without a DAW. Files are streamed block by block and rendered in parallel,
+// one file per worker thread.
+//
+// With --chunk, long files are also split up so that one file keeps every core
+// busy: each chunk starts --warmup ms early from a reset state (like warm_up_len
+// in myk_train.py) so its LSTM state has converged by the time its own audio
+// starts, and renders a --fade ms tail that is crossfaded into the next chunk's
+// start. --verify renders the file serially as well and fails if the stitched
+// output differs by more than --tolerance.
+
+namespace fs = std::filesystem;
 
-// this is the definition of the actual 
-// model architecture, 
-// in this case 1->8->1 lstm->dense (aka linear in torch)
-//using ModelType = RTNeural::ModelT<float, 1, 1, RTNeural::LSTMLayerT<float, 1, 100>, RTNeural::DenseT<float, 100, 1>>;
-using ModelType = RTNeural::ModelT<float, 1, 1, RTNeural::LSTMLayerT<float, 1, 8>, RTNeural::DenseT<float, 8, 1>>;
+struct RenderSettings
+{
+    std::string modelPath;
+    std::string outputDir;
+    std::string suffix = "_dist";
+    float effect = 0.5f;
+    ActivationQuality activations = defaultActivationQuality;
+    int blockSize = 512;
+    int numJobs = (int) std::max (1u, std::thread::hardware_concurrency());
+
+    // chunked rendering, off while chunkSeconds is 0
+    double chunkSeconds = 0.0;
+    double warmUpMs = 500.0;
+    double fadeMs = 10.0;
+    bool verify = false;
+    double tolerance = 1.0e-3;
+};
+
+static void printUsage()
+{
+    std::cout << "usage: distnn-render --model <model.json|model.dnnb> [options] input.wav [input2.wav ...]\n"
+                 "  --effect <0..1>   conditioning value, same as the plugin knob (default 0.5)\n"
+                 "  --activations <exact|high|medium|fast>\n"
+                 "                    gate activation tier, see DistActivations.h (default "
+              << getActivationQualityName (defaultActivationQuality) << ")\n"
+                 "  --block <n>       samples per processing block (default 512)\n"
+                 "  --jobs <n>        files rendered in parallel, or chunks with --chunk (default: number of cores)\n"
+                 "  --chunk <s>       split each file into chunks of s seconds rendered in parallel (default: off)\n"
+                 "  --warmup <ms>     pre-roll before every chunk for the state to converge (default 500)\n"
+                 "  --fade <ms>       crossfade between chunks (default 10)\n"
+                 "  --verify          also render serially and compare, fails above the tolerance\n"
+                 "  --tolerance <x>   largest sample difference --verify accepts (default 1e-3)\n"
+                 "  --out <dir>       output folder (default: next to each input)\n"
+                 "  --suffix <text>   appended to the output file names (default _dist)\n";
+}
 
-void loadModel(std::ifstream& jsonStream, ModelType& model)
+static bool parseArguments (int argc, char* argv[], RenderSettings& settings, std::vector<std::string>& inputs)
 {
-    nlohmann::json modelJson;
-    jsonStream >> modelJson;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
 
-    auto& lstm = model.get<0>();
-    // note that the "lstm." is a prefix used to find the 
-    // lstm data in the json file so your python
-    // needs to name the lstm layer 'lstm' if you use lstm. as your prefix
-    std::string prefix = "lstm.";
-    // for LSTM layers, number of hidden  = number of params in a hidden weight set
-    // divided by 4
-    auto hidden_count = modelJson[prefix + ".weight_ih_l0"].size() / 4;
-    // assert that the number of hidden units is the same as this count
-    // to ensure the json file we are importing matches the model we defined.
-    RTNeural::torch_helpers::loadLSTM<float> (modelJson, prefix, lstm);
-  
-    auto& dense = model.get<1>();
-    // as per the lstm prefix, here the json needs a key prefixed with dense. 
-    RTNeural::torch_helpers::loadDense<float> (modelJson, "dense.", dense);
+        if (arg == "--model" && hasValue)       settings.modelPath = argv[++i];
+        else if (arg == "--effect" && hasValue) settings.effect = std::stof (argv[++i]);
+        else if (arg == "--activations" && hasValue)
+        {
+            if (! getActivationQuality (argv[++i], settings.activations))
+                return false;
+        }
+        else if (arg == "--block" && hasValue)  settings.blockSize = std::stoi (argv[++i]);
+        else if (arg == "--jobs" && hasValue)   settings.numJobs = std::stoi (argv[++i]);
+        else if (arg == "--out" && hasValue)    settings.outputDir = argv[++i];
+        else if (arg == "--suffix" && hasValue) settings.suffix = argv[++i];
+        else if (arg == "--chunk" && hasValue)  settings.chunkSeconds = std::stod (argv[++i]);
+        else if (arg == "--warmup" && hasValue) settings.warmUpMs = std::stod (argv[++i]);
+        else if (arg == "--fade" && hasValue)   settings.fadeMs = std::stod (argv[++i]);
+        else if (arg == "--verify")             settings.verify = true;
+        else if (arg == "--tolerance" && hasValue) settings.tolerance = std::stod (argv[++i]);
+        else if (arg.rfind ("--", 0) == 0)      return false;
+        else                                    inputs.push_back (arg);
+    }
+
+    settings.effect = std::clamp (settings.effect, 0.0f, 1.0f);
+    return ! settings.modelPath.empty() && ! inputs.empty() && settings.blockSize > 0 && settings.numJobs > 0
+        && settings.chunkSeconds >= 0.0 && settings.warmUpMs >= 0.0 && settings.fadeMs >= 0.0;
 }
 
+static std::unique_ptr<DistModelVariant> loadModel (const std::string& path)
+{
+    std::ifstream modelStream (path, std::ifstream::binary);
+
+    if (! modelStream)
+        return nullptr;
+
+    std::stringstream contents;
+    contents << modelStream.rdbuf();
+    const auto data = std::make_shared<const std::string> (contents.str());
+
+    // .dnnb files are used in place, so the engines keep the file contents alive
+    return makeDistModel (data->data(), data->size(), data);
+}
+
+// one engine per channel pair, all sharing the prototype's weights
+static std::vector<DistModelVariant> makeEngines (const DistModelVariant& prototype, int numChannels)
+{
+    std::vector<DistModelVariant> engines ((size_t) (numChannels + 1) / 2, prototype);
+
+    for (auto& engine : engines)
+        std::visit ([] (auto& model) { model.reset(); }, engine);
+
+    return engines;
+}
+
+static void processEngines (std::vector<DistModelVariant>& engines, float* const* channels, int numChannels,
+                            int numFrames, float effect)
+{
+    for (size_t pair = 0; pair < engines.size(); ++pair)
+    {
+        const auto firstChannel = (int) pair * 2;
+        const auto numInPair = std::min (2, numChannels - firstChannel);
+
+        std::visit ([&] (auto& model) { model.process (channels + firstChannel, numInPair, numFrames, effect); },
+                    engines[pair]);
+    }
+}
+
+static bool renderFile (const DistModelVariant& prototype, const std::string& inputPath,
+                        const std::string& outputPath, const RenderSettings& settings, std::string& message)
+{
+    WavReader reader;
+
+    if (! reader.open (inputPath))
+    {
+        message = reader.getError();
+        return false;
+    }
+
+    const auto numChannels = reader.getNumChannels();
+
+    if (reader.getSampleRate() != 44100.0)
+        message = "warning: the models were trained at 44.1 kHz, " + inputPath + " is at "
+                + std::to_string ((int) reader.getSampleRate()) + " Hz\n";
+
+    WavWriter writer;
+
+    if (! writer.open (outputPath, numChannels, reader.getSampleRate()))
+    {
+        message += "cannot write " + outputPath;
+        return false;
+    }
+
+    auto engines = makeEngines (prototype, numChannels);
+
+    std::vector<std::vector<float>> buffers ((size_t) numChannels, std::vector<float> ((size_t) settings.blockSize));
+    std::vector<float*> channels;
+
+    for (auto& buffer : buffers)
+        channels.push_back (buffer.data());
+
+    for (;;)
+    {
+        const auto numFrames = reader.read (channels.data(), settings.blockSize);
+
+        if (numFrames <= 0)
+            break;
+
+        processEngines (engines, channels.data(), numChannels, numFrames, settings.effect);
+
+        if (! writer.write (channels.data(), numFrames))
+        {
+            message += "write error on " + outputPath;
+            return false;
+        }
+    }
+
+    return writer.close();
+}
+
+// Renders [start, end) of the input held in `window` (which starts at file
+// position windowStart) into `output`, starting warmUp samples early from a
+// reset state and running on to tailEnd for the crossfade into the next chunk.
+struct Chunk
+{
+    int64_t start = 0, end = 0, tailEnd = 0, renderStart = 0;
+    std::vector<std::vector<float>> output;   // from renderStart to tailEnd
+};
+
+static void renderChunk (const DistModelVariant& prototype, const std::vector<std::vector<float>>& window,
+                         int64_t windowStart, Chunk& chunk, const RenderSettings& settings)
+{
+    const auto numChannels = (int) window.size();
+    const auto length = (size_t) (chunk.tailEnd - chunk.renderStart);
+    std::vector<float*> channels;
+
+    chunk.output.resize ((size_t) numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto first = window[(size_t) ch].begin() + (chunk.renderStart - windowStart);
+        chunk.output[(size_t) ch].assign (first, first + (std::ptrdiff_t) length);
+        channels.push_back (chunk.output[(size_t) ch].data());
+    }
+
+    auto engines = makeEngines (prototype, numChannels);
+
+    for (size_t done = 0; done < length; done += (size_t) settings.blockSize)
+    {
+        const auto numFrames = (int) std::min ((size_t) settings.blockSize, length - done);
+        processEngines (engines, channels.data(), numChannels, numFrames, settings.effect);
+
+        for (auto& channel : channels)
+            channel += numFrames;
+    }
+}
+
+// Same output file as renderFile, give or take the chunk seams, but the file is
+// read in waves of numJobs chunks that render in parallel; memory stays bounded
+// by one wave whatever the file length.
+static bool renderFileChunked (const DistModelVariant& prototype, const std::string& inputPath,
+                               const std::string& outputPath, const RenderSettings& settings, std::string& message)
+{
+    WavReader reader;
+
+    if (! reader.open (inputPath))
+    {
+        message = reader.getError();
+        return false;
+    }
+
+    const auto numChannels = reader.getNumChannels();
+    const auto sampleRate = reader.getSampleRate();
+
+    if (sampleRate != 44100.0)
+        message = "warning: the models were trained at 44.1 kHz, " + inputPath + " is at "
+                + std::to_string ((int) sampleRate) + " Hz\n";
+
+    WavWriter writer;
+
+    if (! writer.open (outputPath, numChannels, sampleRate))
+    {
+        message += "cannot write " + outputPath;
+        return false;
+    }
+
+    const auto chunkLength = std::max<int64_t> (settings.blockSize, (int64_t) (settings.chunkSeconds * sampleRate));
+    const auto warmUp = (int64_t) (settings.warmUpMs * 0.001 * sampleRate);
+    const auto fade = (int64_t) (settings.fadeMs * 0.001 * sampleRate);
+    const auto waveLength = chunkLength * settings.numJobs;
+
+    // the input from windowStart on: the warm-up history of the previous wave, then this one
+    std::vector<std::vector<float>> window ((size_t) numChannels);
+    int64_t windowStart = 0, waveStart = 0;
+    bool endOfFile = false;
+
+    // the previous chunk's tail, crossfaded into the start of the next one
+    std::vector<std::vector<float>> tail ((size_t) numChannels);
+
+    auto serialEngines = makeEngines (prototype, numChannels);
+    std::vector<std::vector<float>> serial ((size_t) numChannels);
+    double maxError = 0.0, errorEnergy = 0.0, signalEnergy = 0.0;
+
+    std::vector<float> readBuffer ((size_t) (numChannels * settings.blockSize));
+    std::vector<float*> readChannels;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        readChannels.push_back (readBuffer.data() + ch * settings.blockSize);
+
+    for (;;)
+    {
+        // the wave plus the fade of its last chunk
+        while (! endOfFile && windowStart + (int64_t) window[0].size() < waveStart + waveLength + fade)
+        {
+            const auto numFrames = reader.read (readChannels.data(), settings.blockSize);
+            endOfFile = numFrames <= 0;
+
+            for (int ch = 0; ch < numChannels && numFrames > 0; ++ch)
+                window[(size_t) ch].insert (window[(size_t) ch].end(), readChannels[(size_t) ch], readChannels[(size_t) ch] + numFrames);
+        }
+
+        const auto windowEnd = windowStart + (int64_t) window[0].size();
+        const auto waveEnd = std::min (windowEnd, waveStart + waveLength);
+
+        if (waveEnd <= waveStart)
+            break;
+
+        std::vector<Chunk> chunks;
+
+        for (auto start = waveStart; start < waveEnd; start += chunkLength)
+        {
+            Chunk chunk;
+            chunk.start = start;
+            chunk.end = std::min (start + chunkLength, waveEnd);
+            chunk.tailEnd = std::min (chunk.end + fade, windowEnd);
+            chunk.renderStart = std::max<int64_t> (0, start - warmUp);
+            chunks.push_back (std::move (chunk));
+        }
+
+        std::atomic<size_t> nextChunk { 0 };
+        std::vector<std::thread> workers;
+
+        for (size_t i = 0; i < chunks.size(); ++i)
+            workers.emplace_back ([&]
+            {
+                for (auto index = nextChunk++; index < chunks.size(); index = nextChunk++)
+                    renderChunk (prototype, window, windowStart, chunks[index], settings);
+            });
+
+        for (auto& thread : workers)
+            thread.join();
+
+        for (auto& chunk : chunks)
+        {
+            const auto length = (int) (chunk.end - chunk.start);
+            const auto offset = (size_t) (chunk.start - chunk.renderStart);
+            std::vector<float*> channels;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto* out = chunk.output[(size_t) ch].data() + offset;
+                const auto& previous = tail[(size_t) ch];
+
+                // linear crossfade from the previous chunk's tail over the first samples
+                for (size_t n = 0; n < previous.size() && n < (size_t) length; ++n)
+                {
+                    const auto gain = (float) ((double) (n + 1) / (double) (previous.size() + 1));
+                    out[n] = previous[n] + gain * (out[n] - previous[n]);
+                }
+
+                tail[(size_t) ch].assign (out + length, chunk.output[(size_t) ch].data() + chunk.output[(size_t) ch].size());
+                channels.push_back (out);
+            }
+
+            if (! writer.write (channels.data(), length))
+            {
+                message += "write error on " + outputPath;
+                return false;
+            }
+
+            if (settings.verify)
+            {
+                std::vector<float*> serialChannels;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    const auto first = window[(size_t) ch].begin() + (chunk.start - windowStart);
+                    serial[(size_t) ch].assign (first, first + length);
+                    serialChannels.push_back (serial[(size_t) ch].data());
+                }
+
+                for (int done = 0; done < length; done += settings.blockSize)
+                {
+                    const auto numFrames = std::min (settings.blockSize, length - done);
+                    processEngines (serialEngines, serialChannels.data(), numChannels, numFrames, settings.effect);
+
+                    for (auto& channel : serialChannels)
+                        channel += numFrames;
+                }
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    for (int n = 0; n < length; ++n)
+                    {
+                        const auto error = (double) channels[(size_t) ch][n] - serial[(size_t) ch][(size_t) n];
+                        maxError = std::max (maxError, std::abs (error));
+                        errorEnergy += error * error;
+                        signalEnergy += (double) serial[(size_t) ch][(size_t) n] * serial[(size_t) ch][(size_t) n];
+                    }
+                }
+            }
+        }
+
+        // keep what the next wave's first chunk needs for its warm-up
+        waveStart = waveEnd;
+        const auto keepFrom = std::max (windowStart, waveStart - warmUp);
+
+        for (auto& channel : window)
+            channel.erase (channel.begin(), channel.begin() + (keepFrom - windowStart));
+
+        windowStart = keepFrom;
+    }
+
+    if (settings.verify)
+    {
+        const auto esr = signalEnergy > 0.0 ? errorEnergy / signalEnergy : 0.0;
+        std::ostringstream report;
+        report << "verify " << inputPath << ": max error " << maxError << ", ESR " << esr << "\n";
+
+        if (maxError > settings.tolerance)
+            report << "chunked render differs from the serial one by more than " << settings.tolerance << ", try a longer --warmup";
+
+        message += report.str();
+
+        if (maxError > settings.tolerance)
+        {
+            writer.close();
+            return false;
+        }
+    }
+
+    return writer.close();
+}
+
+static std::string getOutputPath (const std::string& inputPath, const RenderSettings& settings)
+{
+    const fs::path input (inputPath);
+    const auto folder = settings.outputDir.empty() ? input.parent_path() : fs::path (settings.outputDir);
+    return (folder / (input.stem().string() + settings.suffix + ".wav")).string();
+}
 
 int main(int argc, char* argv[])
 {
-    auto modelFilePath = " C:/Users/Riccardo/OneDrive - Politecnico di Milano/Desktop/NEURAL PLUG IN/neural_plug_in/neural_plug_in/035c_train_lstm/python/model.json";
-    assert(std::filesystem::exists(modelFilePath));
+    RenderSettings settings;
+    std::vector<std::string> inputs;
+
+    bool validArguments = false;
+
+    try
+    {
+        validArguments = parseArguments (argc, argv, settings, inputs);
+    }
+    catch (const std::exception&)
+    {
+    }
 
-    std::cout << "Loading model from path: " << modelFilePath << std::endl;
-    
-    std::ifstream jsonStream(modelFilePath, std::ifstream::binary);
-    ModelType model;
-    loadModel(jsonStream, model);
-    model.reset();
+    if (! validArguments)
+    {
+        printUsage();
+        return 1;
+    }
 
-    // now take the model for a spin :) 
-    std::vector<float> inputs {1.0, 2.0, 3.0, 4.0};
-    std::vector<float> outputs {};
-    outputs.resize(inputs.size(), {});
+    std::cout << "Loading model from path: " << settings.modelPath << std::endl;
 
-    for(size_t i = 0; i < inputs.size(); ++i)
+    const auto prototype = loadModel (settings.modelPath);
+
+    if (prototype == nullptr)
     {
-        outputs[i] = model.forward(&inputs[i]);
-        std::cout << "in " << inputs[i] << " out: " << outputs[i] << std::endl;
+        std::cerr << "could not load a DIST-NN model from " << settings.modelPath << std::endl;
+        return 1;
     }
+
+    // copied into every engine along with the weights
+    std::visit ([&] (auto& model) { model.setActivationQuality (settings.activations); }, *prototype);
+
+    if (! settings.outputDir.empty())
+        fs::create_directories (settings.outputDir);
+
+    std::atomic<size_t> nextInput { 0 };
+    std::atomic<int> numFailed { 0 };
+    std::mutex logLock;
+
+    auto worker = [&]
+    {
+        for (auto index = nextInput++; index < inputs.size(); index = nextInput++)
+        {
+            const auto outputPath = getOutputPath (inputs[index], settings);
+            std::string message;
+            const auto ok = settings.chunkSeconds > 0.0 ? renderFileChunked (*prototype, inputs[index], outputPath, settings, message)
+                                                        : renderFile (*prototype, inputs[index], outputPath, settings, message);
+
+            std::lock_guard<std::mutex> lock (logLock);
+            std::cout << message << (message.empty() || message.back() == '\n' ? "" : "\n");
+
+            if (ok)
+                std::cout << inputs[index] << " -> " << outputPath << std::endl;
+            else
+                ++numFailed;
+        }
+    };
+
+    // chunked files use all the jobs themselves, so they go one at a time
+    std::vector<std::thread> workers;
+    const auto numWorkers = settings.chunkSeconds > 0.0 ? (size_t) 1 : std::min ((size_t) settings.numJobs, inputs.size());
+
+    for (size_t i = 0; i < numWorkers; ++i)
+        workers.emplace_back (worker);
+
+    for (auto& thread : workers)
+        thread.join();
+
+    return numFailed == 0 ? 0 : 1;
 }
@@ -52,3 +52,32 @@ class SimpleLSTM(torch.nn.Module):
             
         with open(outfile, 'w') as json_file:
             json.dump(self.state_dict(), json_file,cls=EncodeTensor)
+
+
+class SimpleGRU(torch.nn.Module):
+    """
+    Same model with a GRU instead of the LSTM: three gates instead of four and
+    no cell state, so about a quarter less work per sample for the same width.
+    The state dict uses the "gru." prefix, which the plugin looks for to pick
+    its GRU engine.
+    """
+    def __init__(self, hidden_size=16):
+        super().__init__()
+        self.gru = torch.nn.GRU(2, hidden_size, batch_first=True)
+        self.dense = torch.nn.Linear(hidden_size, 1)
+        self.drop_hidden = True
+
+    def forward(self, torch_in):
+        if self.drop_hidden:
+            batch_size = torch_in.shape[0]
+            h_shape = [self.gru.num_layers, batch_size, self.gru.hidden_size]
+            hidden = torch.zeros(h_shape).to(torch_in.device)
+            x, _ = self.gru(torch_in, hidden)
+            self.drop_hidden = False
+        else:
+            x, _ = self.gru(torch_in)
+        return self.dense(x)
+
+    # same state handling and export as SimpleLSTM
+    zero_on_next_forward = SimpleLSTM.zero_on_next_forward
+    save_for_rtneural = SimpleLSTM.save_for_rtneural
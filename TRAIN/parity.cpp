@@ -0,0 +1,141 @@
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "DistModels.h"
+#include "WavFile.h"
+
+// Parity check between two versions of the same model, typically the float
+// model and its float16/int8 conversion: renders WAV files (e.g. the reference
+// renders in OUTPUTS/) through both and reports the difference. Exits with an
+// error when the error-to-signal ratio goes over the tolerance.
+//
+// usage: distnn-parity --reference model.dnnb --candidate model.int8.dnnb
+//                      [--effect 0.8] [--max-esr 1e-3] input.wav [...]
+
+struct Difference
+{
+    double maxAbs = 0.0, errorEnergy = 0.0, signalEnergy = 0.0;
+    long long numSamples = 0;
+
+    double getEsr() const { return signalEnergy > 0.0 ? errorEnergy / signalEnergy : errorEnergy; }
+};
+
+static std::unique_ptr<DistModelVariant> loadModel (const std::string& path)
+{
+    std::ifstream modelStream (path, std::ifstream::binary);
+    std::stringstream contents;
+    contents << modelStream.rdbuf();
+    const auto data = std::make_shared<const std::string> (contents.str());
+    return makeDistModel (data->data(), data->size(), data);
+}
+
+static bool compare (DistModelVariant reference, DistModelVariant candidate, const std::string& path,
+                     float effect, Difference& difference)
+{
+    WavReader reader;
+
+    if (! reader.open (path))
+    {
+        std::cerr << reader.getError() << std::endl;
+        return false;
+    }
+
+    constexpr int blockSize = 512;
+    std::vector<float> left (blockSize), right (blockSize);
+
+    for (auto* model : { &reference, &candidate })
+        std::visit ([] (auto& m) { m.reset(); }, *model);
+
+    // only the first channel is compared, the models are mono per lane anyway
+    std::vector<std::vector<float>> file ((size_t) reader.getNumChannels(), std::vector<float> (blockSize));
+    std::vector<float*> fileChannels;
+
+    for (auto& channel : file)
+        fileChannels.push_back (channel.data());
+
+    for (;;)
+    {
+        const auto numFrames = reader.read (fileChannels.data(), blockSize);
+
+        if (numFrames <= 0)
+            return true;
+
+        std::copy (file[0].begin(), file[0].begin() + numFrames, left.begin());
+        std::copy (file[0].begin(), file[0].begin() + numFrames, right.begin());
+
+        float* referenceChannels[] = { left.data() };
+        float* candidateChannels[] = { right.data() };
+        std::visit ([&] (auto& m) { m.process (referenceChannels, 1, numFrames, effect); }, reference);
+        std::visit ([&] (auto& m) { m.process (candidateChannels, 1, numFrames, effect); }, candidate);
+
+        for (int n = 0; n < numFrames; ++n)
+        {
+            const double error = (double) right[(size_t) n] - (double) left[(size_t) n];
+            difference.maxAbs = std::max (difference.maxAbs, std::abs (error));
+            difference.errorEnergy += error * error;
+            difference.signalEnergy += (double) left[(size_t) n] * (double) left[(size_t) n];
+        }
+
+        difference.numSamples += numFrames;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    std::string referencePath, candidatePath;
+    std::vector<std::string> inputs;
+    float effect = 0.8f;
+    double maxEsr = 1.0e-3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--reference" && hasValue)      referencePath = argv[++i];
+        else if (arg == "--candidate" && hasValue) candidatePath = argv[++i];
+        else if (arg == "--effect" && hasValue)    effect = std::stof (argv[++i]);
+        else if (arg == "--max-esr" && hasValue)   maxEsr = std::stod (argv[++i]);
+        else                                       inputs.push_back (arg);
+    }
+
+    if (referencePath.empty() || candidatePath.empty() || inputs.empty())
+    {
+        std::cerr << "usage: distnn-parity --reference <model> --candidate <model> [--effect 0.8] [--max-esr 1e-3] input.wav [...]" << std::endl;
+        return 1;
+    }
+
+    const auto reference = loadModel (referencePath);
+    const auto candidate = loadModel (candidatePath);
+
+    if (reference == nullptr || candidate == nullptr)
+    {
+        std::cerr << "could not load " << (reference == nullptr ? referencePath : candidatePath) << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+
+    for (const auto& input : inputs)
+    {
+        Difference difference;
+
+        if (! compare (*reference, *candidate, input, effect, difference))
+        {
+            ok = false;
+            continue;
+        }
+
+        const auto passed = difference.getEsr() <= maxEsr;
+        ok = ok && passed;
+
+        std::cout << (passed ? "ok    " : "FAIL  ") << input << ": esr " << difference.getEsr()
+                  << ", max abs error " << difference.maxAbs << " over " << difference.numSamples << " samples" << std::endl;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "NativeRateProcessor.h"
+
+// Frequency response of the plug in's "Run at model rate" round trip: host rate
+// down to the model rate, nothing in between, and back up. Sines are sent
+// through at every host rate and the component at the input frequency is fitted
+// out of the output. Reports, per rate:
+//   ripple     largest gain error from 20 Hz to 20 kHz, in dB
+//   products   largest level of everything else (aliases and images) while
+//              playing those sines, relative to the sine, in dB
+//   stopband   largest output level for sines the model rate cannot carry
+//              (from 24.1 kHz, whose aliases would land below 20 kHz), in dB;
+//              none at 48 kHz, whose Nyquist frequency is lower
+// Exits with an error when a rate is outside the limits.
+//
+// usage: distnn-resampler [--rates 48000,88200,96000,192000] [--model-rate 44100]
+//                         [--max-ripple 0.1] [--max-products -80] [--max-stopband -80]
+
+struct Response
+{
+    double ripple = 0.0, products = -400.0, stopband = -400.0;
+    bool hasStopband = false;
+};
+
+static double toDecibels (double gain)
+{
+    return 20.0 * std::log10 (std::max (gain, 1.0e-20));
+}
+
+// Plays a sine at `frequency` through the round trip and returns its gain and
+// the level of what is left once the sine is fitted out, both relative to the input.
+static void measure (NativeRateProcessor& processor, double hostRate, double frequency, double& gain, double& residual)
+{
+    constexpr int blockSize = 512;
+    const auto settle = processor.getLatencySamples() + 4 * blockSize;
+    const auto numSamples = settle + (int) hostRate / 4;
+    const double amplitude = 0.5, w = 2.0 * 3.14159265358979323846 * frequency / hostRate;
+
+    std::vector<float> signal ((size_t) numSamples);
+
+    for (int n = 0; n < numSamples; ++n)
+        signal[(size_t) n] = (float) (amplitude * std::sin (w * n));
+
+    processor.reset();
+
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        float* channels[] = { signal.data() + start };
+        processor.process (channels, 1, std::min (blockSize, numSamples - start), [] (float* const*, int, int) {});
+    }
+
+    // least squares fit of a sin + b cos over the settled part
+    double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0, yy = 0.0;
+
+    for (int n = settle; n < numSamples; ++n)
+    {
+        const double s = std::sin (w * n), c = std::cos (w * n), y = signal[(size_t) n];
+        ss += s * s; cc += c * c; sc += s * c;
+        ys += y * s; yc += y * c; yy += y * y;
+    }
+
+    const auto determinant = ss * cc - sc * sc;
+    const auto a = (ys * cc - yc * sc) / determinant;
+    const auto b = (yc * ss - ys * sc) / determinant;
+    const auto fittedEnergy = a * ys + b * yc;
+    const auto numFitted = (double) (numSamples - settle);
+
+    gain = std::sqrt (a * a + b * b) / amplitude;
+    residual = std::sqrt (std::max (0.0, yy - fittedEnergy) / numFitted) / (amplitude / std::sqrt (2.0));
+}
+
+static Response measureRate (double hostRate, double modelRate)
+{
+    NativeRateProcessor processor;
+    processor.prepare (hostRate, modelRate, 512, 1);
+
+    Response response;
+
+    // log-spaced from 20 Hz, ending exactly on 20 kHz
+    for (int i = 0; i <= 60; ++i)
+    {
+        const auto frequency = 20.0 * std::pow (1000.0, i / 60.0);
+        double gain, residual;
+        measure (processor, hostRate, frequency, gain, residual);
+
+        response.ripple = std::max (response.ripple, std::abs (toDecibels (gain)));
+        response.products = std::max (response.products, toDecibels (residual));
+    }
+
+    for (auto frequency = modelRate - 20000.0; frequency < 0.49 * hostRate; frequency += 1000.0)
+    {
+        double gain, residual;
+        measure (processor, hostRate, frequency, gain, residual);
+
+        // the sine itself is gone; whatever came out instead is its alias
+        response.stopband = std::max (response.stopband, toDecibels (std::hypot (gain / std::sqrt (2.0), residual)));
+        response.hasStopband = true;
+    }
+
+    return response;
+}
+
+static std::vector<double> parseList (const std::string& text)
+{
+    std::vector<double> values;
+    size_t start = 0;
+
+    while (start < text.size())
+    {
+        const auto end = std::min (text.find (',', start), text.size());
+        values.push_back (std::stod (text.substr (start, end - start)));
+        start = end + 1;
+    }
+
+    return values;
+}
+
+int main (int argc, char* argv[])
+{
+    std::vector<double> rates { 48000.0, 88200.0, 96000.0, 192000.0 };
+    double modelRate = 44100.0, maxRipple = 0.1, maxProducts = -80.0, maxStopband = -80.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--rates" && hasValue)             rates = parseList (argv[++i]);
+        else if (arg == "--model-rate" && hasValue)   modelRate = std::stod (argv[++i]);
+        else if (arg == "--max-ripple" && hasValue)   maxRipple = std::stod (argv[++i]);
+        else if (arg == "--max-products" && hasValue) maxProducts = std::stod (argv[++i]);
+        else if (arg == "--max-stopband" && hasValue) maxStopband = std::stod (argv[++i]);
+        else
+        {
+            std::cerr << "usage: distnn-resampler [--rates 48000,88200,96000,192000] [--model-rate 44100]"
+                         " [--max-ripple 0.1] [--max-products -80] [--max-stopband -80]" << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision (2);
+
+    for (const auto rate : rates)
+    {
+        NativeRateProcessor processor;
+        processor.prepare (rate, modelRate, 512, 1);
+
+        if (! processor.isActive())
+        {
+            std::cout << "skip  " << (int) rate << " Hz: runs at the model rate or has no usable ratio" << std::endl;
+            continue;
+        }
+
+        const auto response = measureRate (rate, modelRate);
+        const auto passed = response.ripple <= maxRipple && response.products <= maxProducts && response.stopband <= maxStopband;
+        ok = ok && passed;
+
+        std::cout << (passed ? "ok    " : "FAIL  ") << (int) rate << " Hz: ripple " << response.ripple << " dB, products "
+                  << response.products << " dB, stopband ";
+
+        if (response.hasStopband)
+            std::cout << response.stopband << " dB";
+        else
+            std::cout << "-";
+
+        std::cout << ", latency " << processor.getLatencySamples() << " samples" << std::endl;
+    }
+
+    return ok ? 0 : 1;
+}
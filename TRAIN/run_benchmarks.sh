@@ -0,0 +1,28 @@
+#!/bin/sh
+# Builds distnn-bench once per RTNeural backend and merges the results in one CSV.
+# usage: ./run_benchmarks.sh [results.csv]
+
+set -e
+cd "$(dirname "$0")"
+OUT="${1:-benchmark_results.csv}"
+
+bench_backend () {
+    BUILD_DIR="build-bench-$1"
+    shift
+    cmake -S . -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release "$@" > /dev/null
+    cmake --build "$BUILD_DIR" --config Release --target distnn-bench > /dev/null
+    BENCH="$BUILD_DIR/distnn-bench"
+    [ -x "$BENCH" ] || BENCH="$BUILD_DIR/Release/distnn-bench"
+    "$BENCH" --models ../DIST-NN/Models --out "$BUILD_DIR/results.csv"
+}
+
+bench_backend eigen -DRTNEURAL_EIGEN=ON -DRTNEURAL_XSIMD=OFF -DRTNEURAL_STL=OFF
+bench_backend xsimd -DRTNEURAL_EIGEN=OFF -DRTNEURAL_XSIMD=ON -DRTNEURAL_STL=OFF
+bench_backend stl -DRTNEURAL_EIGEN=OFF -DRTNEURAL_XSIMD=OFF -DRTNEURAL_STL=ON
+
+head -n 1 build-bench-eigen/results.csv > "$OUT"
+for backend in eigen xsimd stl; do
+    tail -n +2 "build-bench-$backend/results.csv" >> "$OUT"
+done
+
+echo "results written to $OUT"
@@ -0,0 +1,525 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "DistModels.h"
+#include "WavFile.h"
+
+// Accuracy vs cost sweep over every model and every way of running it (kernel):
+// the plain RTNeural model, the DistLSTM engine with float32, float16 and int8
+// weights, and both weight types again with each approximate activation tier
+// (float32-high, int8-fast, ...; see DistActivations.h). GRU models found next
+// to the LSTM ones (modelParametricGRU16.json, ...) are swept as well, with the
+// gru- kernels: RTNeural's GRU as their reference, DistGRU with float32 and
+// float16 weights, and float32 with each activation tier.
+//
+// Each model/kernel renders the input over a grid of effect values and is
+// compared with
+//  - the target audio for that effect when one is given (e.g. the Python MSE.py
+//    comparison against OUTPUTS/TARGET_GUITAR_0.8.wav), and
+//  - the RTNeural render of the same model, the exact reference, and
+//  - the RTNeural render of the largest model, which stands in for the target
+//    when there is none,
+// as ESR (error energy / target energy) and MSE. The effect values are rendered
+// in parallel; the cost of every model/kernel is then timed on its own, one at a
+// time, and a Pareto table of error vs ns/sample tells which kernels are worth
+// shipping: anything off the front is slower and less accurate than something else.
+//
+// usage: distnn-sweep [--models <dir>] [--input dry.wav] [--target 0.8=target.wav ...]
+//                     [--effects 0,0.2,...] [--jobs n] [--seconds s] [--out rows.csv]
+
+namespace
+{
+constexpr int renderBlockSize = 512;
+
+struct SweepSettings
+{
+    std::string modelsDir = "../DIST-NN/Models";
+    std::string inputPath, outputPath;
+    std::map<float, std::string> targetPaths;
+    std::vector<float> effects { 0.0f, 0.2f, 0.4f, 0.6f, 0.8f, 1.0f };
+    int numJobs = (int) std::max (1u, std::thread::hardware_concurrency());
+    double secondsToTime = 2.0;
+};
+
+// One way of running one model. render() processes a mono signal in place from
+// a freshly reset state, so it can be called from several threads at once.
+struct Candidate
+{
+    int hiddenSize;
+    std::string kernel;
+    std::function<void (std::vector<float>&, float)> render;
+};
+
+struct Error
+{
+    double esr = 0.0, mse = 0.0;
+    bool valid = false;
+};
+
+struct Row
+{
+    int hiddenSize;
+    std::string kernel;
+    float effect;
+    Error target, reference, largest;
+};
+
+Error computeError (const std::vector<float>& output, const std::vector<float>& target)
+{
+    const auto length = std::min (output.size(), target.size());
+    double errorEnergy = 0.0, targetEnergy = 0.0;
+
+    for (size_t n = 0; n < length; ++n)
+    {
+        const auto error = (double) output[n] - (double) target[n];
+        errorEnergy += error * error;
+        targetEnergy += (double) target[n] * (double) target[n];
+    }
+
+    if (length == 0)
+        return {};
+
+    return { targetEnergy > 0.0 ? errorEnergy / targetEnergy : errorEnergy, errorEnergy / (double) length, true };
+}
+
+// Renders block by block with a copy of `prototype`, the way the plugin and distnn-render do.
+template <typename Engine>
+std::function<void (std::vector<float>&, float)> makeEngineRender (Engine prototype)
+{
+    return [prototype] (std::vector<float>& signal, float effect)
+    {
+        auto engine = prototype;
+        engine.reset();
+
+        for (size_t start = 0; start < signal.size(); start += renderBlockSize)
+        {
+            float* channels[] = { signal.data() + start };
+            engine.process (channels, 1, (int) std::min ((size_t) renderBlockSize, signal.size() - start), effect);
+        }
+    };
+}
+
+template <int hiddenSize>
+void addCandidates (const std::shared_ptr<const nlohmann::json>& modelJson, std::vector<Candidate>& candidates)
+{
+    const auto weights = loadDistWeights<hiddenSize> (*modelJson);
+
+    if (weights == nullptr)
+        return;
+
+    // the reference: RTNeural's LSTM and Dense, one sample at a time, as the plugin originally ran
+    candidates.push_back ({ hiddenSize, "rtneural", [modelJson] (std::vector<float>& signal, float effect)
+    {
+        auto model = std::make_unique<DistModelT<hiddenSize>>();
+        loadDistModel (*modelJson, *model);
+        model->reset();
+
+        for (auto& sample : signal)
+        {
+            const float input[] = { sample, effect };
+            sample = model->forward (input);
+        }
+    } });
+
+    candidates.push_back ({ hiddenSize, "float32", makeEngineRender (DistLSTM<hiddenSize, 1> (weights)) });
+
+    const auto halfFile = writeDistModelFile (*weights, DistModelFileHeader::float16);
+    const auto halfWeights = readDistWeights<hiddenSize> (halfFile.data(), halfFile.size());
+    candidates.push_back ({ hiddenSize, "float16", makeEngineRender (DistLSTM<hiddenSize, 1> (halfWeights)) });
+
+    const auto quantized = DistQuantizedWeights<hiddenSize>::quantize (*weights);
+    candidates.push_back ({ hiddenSize, "int8", makeEngineRender (DistQuantizedLSTM<hiddenSize, 1> (quantized)) });
+
+    // the approximate gate activations, on top of the float32 and int8 weights
+    for (int i = 1; i < numActivationQualities; ++i)
+    {
+        const auto quality = (ActivationQuality) i;
+        const auto suffix = std::string ("-") + getActivationQualityName (quality);
+
+        DistLSTM<hiddenSize, 1> engine (weights);
+        engine.setActivationQuality (quality);
+        candidates.push_back ({ hiddenSize, "float32" + suffix, makeEngineRender (engine) });
+
+        DistQuantizedLSTM<hiddenSize, 1> quantizedEngine (quantized);
+        quantizedEngine.setActivationQuality (quality);
+        candidates.push_back ({ hiddenSize, "int8" + suffix, makeEngineRender (quantizedEngine) });
+    }
+}
+
+template <int hiddenSize>
+void addGRUCandidates (const std::shared_ptr<const nlohmann::json>& modelJson, std::vector<Candidate>& candidates)
+{
+    const auto weights = loadDistGRUWeights<hiddenSize> (*modelJson);
+
+    if (weights == nullptr)
+        return;
+
+    candidates.push_back ({ hiddenSize, "gru-rtneural", [modelJson] (std::vector<float>& signal, float effect)
+    {
+        auto model = std::make_unique<DistGRUModelT<hiddenSize>>();
+        loadDistModel (*modelJson, *model);
+        model->reset();
+
+        for (auto& sample : signal)
+        {
+            const float input[] = { sample, effect };
+            sample = model->forward (input);
+        }
+    } });
+
+    candidates.push_back ({ hiddenSize, "gru-float32", makeEngineRender (DistGRU<hiddenSize, 1> (weights)) });
+
+    const auto halfFile = writeDistModelFile (*weights, DistModelFileHeader::float16);
+    const auto halfWeights = readDistGRUWeights<hiddenSize> (halfFile.data(), halfFile.size());
+    candidates.push_back ({ hiddenSize, "gru-float16", makeEngineRender (DistGRU<hiddenSize, 1> (halfWeights)) });
+
+    for (int i = 1; i < numActivationQualities; ++i)
+    {
+        const auto quality = (ActivationQuality) i;
+
+        DistGRU<hiddenSize, 1> engine (weights);
+        engine.setActivationQuality (quality);
+        candidates.push_back ({ hiddenSize, std::string ("gru-float32-") + getActivationQualityName (quality), makeEngineRender (engine) });
+    }
+}
+
+bool loadJson (const std::string& path, nlohmann::json& modelJson)
+{
+    std::ifstream jsonStream (path, std::ifstream::binary);
+
+    if (! jsonStream)
+        return false;
+
+    try
+    {
+        jsonStream >> modelJson;
+        return true;
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        return false;
+    }
+}
+
+bool loadMono (const std::string& path, std::vector<float>& signal, std::string& error)
+{
+    WavReader reader;
+
+    if (! reader.open (path))
+    {
+        error = reader.getError();
+        return false;
+    }
+
+    if (reader.getSampleRate() != distModelSampleRate)
+        std::cerr << "warning: the models were trained at 44.1 kHz, " << path << " is at " << reader.getSampleRate() << " Hz" << std::endl;
+
+    // first channel only, as MSE.py does
+    std::vector<std::vector<float>> buffers ((size_t) reader.getNumChannels(), std::vector<float> (4096));
+    std::vector<float*> channels;
+
+    for (auto& buffer : buffers)
+        channels.push_back (buffer.data());
+
+    signal.clear();
+
+    for (int numFrames; (numFrames = reader.read (channels.data(), 4096)) > 0;)
+        signal.insert (signal.end(), buffers[0].begin(), buffers[0].begin() + numFrames);
+
+    return true;
+}
+
+std::vector<float> makeTestSignal (int numSamples)
+{
+    // a few plucks with a decaying envelope and a little noise, when no input is given
+    std::vector<float> signal ((size_t) numSamples);
+    uint32_t seed = 12345u;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const auto noise = (float) (seed >> 8) / 16777216.0f - 0.5f;
+        const auto t = (float) (n % 22050) / (float) distModelSampleRate;
+        const auto frequency = 82.4f * (float) (1 + (n / 22050) % 4);
+        signal[(size_t) n] = 0.6f * std::exp (-4.0f * t) * std::sin (2.0f * 3.14159265f * frequency * t) + 0.01f * noise;
+    }
+
+    return signal;
+}
+
+double timeCandidate (const Candidate& candidate, const std::vector<float>& input, double seconds)
+{
+    const auto length = std::min (input.size(), (size_t) (seconds * distModelSampleRate));
+    std::vector<float> signal (input.begin(), input.begin() + (std::ptrdiff_t) length);
+
+    // best of three, to keep other processes out of the numbers
+    double best = 0.0;
+
+    for (int run = 0; run < 3; ++run)
+    {
+        std::copy (input.begin(), input.begin() + (std::ptrdiff_t) length, signal.begin());
+        const auto start = std::chrono::steady_clock::now();
+        candidate.render (signal, 0.5f);
+        const auto elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+        best = run == 0 ? elapsed : std::min (best, elapsed);
+    }
+
+    return best * 1.0e9 / (double) std::max ((size_t) 1, length);
+}
+
+std::vector<float> parseList (const std::string& text)
+{
+    std::vector<float> values;
+    std::stringstream stream (text);
+
+    for (std::string item; std::getline (stream, item, ',');)
+        values.push_back (std::stof (item));
+
+    return values;
+}
+
+bool parseArguments (int argc, char* argv[], SweepSettings& settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--models" && hasValue)       settings.modelsDir = argv[++i];
+        else if (arg == "--input" && hasValue)   settings.inputPath = argv[++i];
+        else if (arg == "--effects" && hasValue) settings.effects = parseList (argv[++i]);
+        else if (arg == "--jobs" && hasValue)    settings.numJobs = std::stoi (argv[++i]);
+        else if (arg == "--seconds" && hasValue) settings.secondsToTime = std::stod (argv[++i]);
+        else if (arg == "--out" && hasValue)     settings.outputPath = argv[++i];
+        else if (arg == "--target" && hasValue)
+        {
+            const std::string value = argv[++i];
+            const auto separator = value.find ('=');
+
+            if (separator == std::string::npos)
+                return false;
+
+            settings.targetPaths[std::stof (value.substr (0, separator))] = value.substr (separator + 1);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // targets are only useful with the dry signal they were made from
+    return settings.numJobs > 0 && (settings.targetPaths.empty() || ! settings.inputPath.empty());
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    SweepSettings settings;
+    bool validArguments = false;
+
+    try
+    {
+        validArguments = parseArguments (argc, argv, settings);
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    if (! validArguments)
+    {
+        std::cerr << "usage: distnn-sweep [--models <dir>] [--input dry.wav] [--target <effect>=<target.wav> ...]\n"
+                     "                    [--effects 0,0.2,0.4,0.6,0.8,1] [--jobs <n>] [--seconds <timed audio>] [--out <rows.csv>]" << std::endl;
+        return 1;
+    }
+
+    std::vector<float> input;
+    std::string error;
+
+    if (settings.inputPath.empty())
+        input = makeTestSignal ((int) (10.0 * distModelSampleRate));
+    else if (! loadMono (settings.inputPath, input, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::map<float, std::vector<float>> targets;
+
+    for (const auto& [effect, path] : settings.targetPaths)
+    {
+        if (! loadMono (path, targets[effect], error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+
+        if (std::find (settings.effects.begin(), settings.effects.end(), effect) == settings.effects.end())
+            settings.effects.push_back (effect);
+    }
+
+    std::vector<Candidate> candidates;
+
+    for (int i = 0; i < numModelSizes; ++i)
+    {
+        const auto hiddenSize = getHiddenSize ((ModelSize) i);
+        const auto path = settings.modelsDir + "/modelParametricDIST" + std::to_string (hiddenSize) + ".json";
+        auto modelJson = std::make_shared<nlohmann::json>();
+
+        if (! loadJson (path, *modelJson))
+        {
+            std::cerr << "skipping " << path << std::endl;
+            continue;
+        }
+
+        withHiddenSize ((ModelSize) i, [&] (auto size) { addCandidates<size> (modelJson, candidates); });
+
+        // the GRU variant of the same size, when one has been trained
+        auto gruJson = std::make_shared<nlohmann::json>();
+
+        if (loadJson (settings.modelsDir + "/modelParametricGRU" + std::to_string (hiddenSize) + ".json", *gruJson))
+            withHiddenSize ((ModelSize) i, [&] (auto size) { addGRUCandidates<size> (gruJson, candidates); });
+    }
+
+    if (candidates.empty())
+    {
+        std::cerr << "no models found in " << settings.modelsDir << std::endl;
+        return 1;
+    }
+
+    // the rtneural candidate of the largest model
+    const auto largest = std::max_element (candidates.begin(), candidates.end(), [] (const Candidate& a, const Candidate& b)
+    {
+        return std::make_tuple (a.hiddenSize, a.kernel == "rtneural") < std::make_tuple (b.hiddenSize, b.kernel == "rtneural");
+    });
+
+    // accuracy: one job per effect value, each rendering every model/kernel
+    std::vector<Row> rows;
+    std::mutex rowsLock;
+    std::atomic<size_t> nextEffect { 0 };
+
+    auto worker = [&]
+    {
+        for (auto index = nextEffect++; index < settings.effects.size(); index = nextEffect++)
+        {
+            const auto effect = settings.effects[index];
+            const auto target = targets.find (effect);
+            std::vector<float> reference, largestReference = input;
+            std::vector<Row> effectRows;
+
+            largest->render (largestReference, effect);
+
+            for (const auto& candidate : candidates)
+            {
+                auto output = input;
+                candidate.render (output, effect);
+
+                // the first kernel of every model is its RTNeural reference
+                if (candidate.kernel == "rtneural" || candidate.kernel == "gru-rtneural")
+                    reference = output;
+
+                Row row { candidate.hiddenSize, candidate.kernel, effect, {}, computeError (output, reference),
+                          computeError (output, largestReference) };
+
+                if (target != targets.end())
+                    row.target = computeError (output, target->second);
+
+                effectRows.push_back (row);
+            }
+
+            std::lock_guard<std::mutex> lock (rowsLock);
+            rows.insert (rows.end(), effectRows.begin(), effectRows.end());
+            std::cerr << "effect " << effect << " done" << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < std::min ((size_t) settings.numJobs, settings.effects.size()); ++i)
+        workers.emplace_back (worker);
+
+    for (auto& thread : workers)
+        thread.join();
+
+    std::sort (rows.begin(), rows.end(), [] (const Row& a, const Row& b)
+    {
+        return std::tie (a.hiddenSize, a.kernel, a.effect) < std::tie (b.hiddenSize, b.kernel, b.effect);
+    });
+
+    if (! settings.outputPath.empty())
+    {
+        std::ofstream out (settings.outputPath);
+        out << "hidden,kernel,effect,esr_target,mse_target,esr_reference,mse_reference,esr_largest\n";
+
+        auto field = [] (double value, bool valid) { return valid ? std::to_string (value) : std::string(); };
+
+        for (const auto& row : rows)
+            out << row.hiddenSize << ',' << row.kernel << ',' << row.effect << ','
+                << field (row.target.esr, row.target.valid) << ',' << field (row.target.mse, row.target.valid) << ','
+                << row.reference.esr << ',' << row.reference.mse << ',' << row.largest.esr << '\n';
+    }
+
+    // cost: timed one at a time, nothing else running
+    struct Point
+    {
+        int hiddenSize;
+        std::string kernel;
+        double error, nsPerSample;
+        bool pareto = true;
+    };
+
+    std::vector<Point> points;
+
+    for (const auto& candidate : candidates)
+    {
+        // error: the mean ESR against the targets, or against the largest model when there are none
+        double sum = 0.0;
+        int count = 0;
+
+        for (const auto& row : rows)
+        {
+            if (row.hiddenSize == candidate.hiddenSize && row.kernel == candidate.kernel && (targets.empty() || row.target.valid))
+            {
+                sum += targets.empty() ? row.largest.esr : row.target.esr;
+                ++count;
+            }
+        }
+
+        points.push_back ({ candidate.hiddenSize, candidate.kernel, count > 0 ? sum / count : 0.0,
+                            timeCandidate (candidate, input, settings.secondsToTime) });
+    }
+
+    if (targets.empty())
+        std::cout << "error: mean ESR against the " << largest->hiddenSize << " hidden RTNeural render" << std::endl;
+    else
+        std::cout << "error: mean ESR against the target audio" << std::endl;
+
+    for (auto& point : points)
+        for (const auto& other : points)
+            if (other.error <= point.error && other.nsPerSample <= point.nsPerSample
+                && (other.error < point.error || other.nsPerSample < point.nsPerSample))
+                point.pareto = false;
+
+    std::sort (points.begin(), points.end(), [] (const Point& a, const Point& b) { return a.nsPerSample < b.nsPerSample; });
+
+    std::cout << std::left << std::setw (8) << "hidden" << std::setw (16) << "kernel" << std::setw (16) << "ns/sample"
+              << std::setw (16) << "error" << "pareto" << std::endl;
+
+    for (const auto& point : points)
+        std::cout << std::left << std::setw (8) << point.hiddenSize << std::setw (16) << point.kernel
+                  << std::setw (16) << point.nsPerSample << std::setw (16) << point.error << (point.pareto ? "*" : "") << std::endl;
+
+    return 0;
+}